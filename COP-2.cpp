@@ -1,10 +1,42 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
 #include <fstream>
+#include <iomanip>
+#include <ctime>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <limits>
+#include <charconv>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <type_traits>
+#include <unordered_set>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Build with -DERROR_NO_ALLOC_HOOK to leave operator new alone
+#ifdef ERROR_NO_ALLOC_HOOK
+#define BENCH_NO_ALLOC_HOOK
+#endif
+#include "bench_support.h"
 
 // Error severity levels
 enum class ErrorLevel {
@@ -14,6 +46,18 @@ enum class ErrorLevel {
     CRITICAL = 3
 };
 
+// Compile-time minimum level: log calls below it compile away entirely.
+// Build with e.g. -DERROR_MIN_LEVEL=2 to strip INFO and WARNING logging.
+#ifndef ERROR_MIN_LEVEL
+#define ERROR_MIN_LEVEL 0
+#endif
+
+constexpr ErrorLevel kMinCompiledLevel = static_cast<ErrorLevel>(ERROR_MIN_LEVEL);
+
+constexpr unsigned levelBit(ErrorLevel level) {
+    return 1u << static_cast<unsigned>(level);
+}
+
 // Error data structure
 struct ErrorContext {
     ErrorLevel level;
@@ -27,141 +71,1384 @@ struct ErrorContext {
           timestamp(std::chrono::system_clock::now()) {}
 };
 
+// Interns component names into small integer IDs. The first sighting of a
+// name takes a lock; after that each thread resolves it from a small
+// direct-mapped cache without locking or allocating, and ID -> name lookups
+// are plain atomic loads.
+class ComponentRegistry {
+public:
+    static constexpr uint16_t kMaxComponents = 4096;
+    static constexpr uint16_t kOverflowId = 0;  // "<other>" once the table is full
+    
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, uint16_t> ids;
+    std::deque<std::string> names;  // deque keeps addresses stable
+    std::atomic<const std::string*> table[kMaxComponents] = {};
+    std::atomic<uint16_t> count{0};
+    
+    struct CacheEntry {
+        uint64_t hash = 0;
+        uint16_t id = 0;
+        bool used = false;
+    };
+    
+    static uint64_t hashName(std::string_view name) {
+        uint64_t hash = 1469598103934665603ull;  // FNV-1a
+        for (char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+    
+    ComponentRegistry() {
+        names.emplace_back("<other>");
+        table[kOverflowId].store(&names.back(), std::memory_order_release);
+        count.store(1, std::memory_order_release);
+    }
+    
+    uint16_t internSlow(std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string key(name);
+        auto it = ids.find(key);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        uint16_t id = count.load(std::memory_order_relaxed);
+        if (id >= kMaxComponents) {
+            return kOverflowId;
+        }
+        names.push_back(key);
+        table[id].store(&names.back(), std::memory_order_release);
+        ids.emplace(std::move(key), id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+    
+public:
+    static ComponentRegistry& instance() {
+        static ComponentRegistry registry;
+        return registry;
+    }
+    
+    uint16_t intern(std::string_view name) {
+        thread_local CacheEntry cache[256];
+        uint64_t hash = hashName(name);
+        CacheEntry& entry = cache[hash & 255];
+        if (entry.used && entry.hash == hash && this->name(entry.id) == name) {
+            return entry.id;
+        }
+        uint16_t id = internSlow(name);
+        entry = CacheEntry{hash, id, true};
+        return id;
+    }
+    
+    std::string_view name(uint16_t id) const {
+        if (id >= count.load(std::memory_order_acquire)) {
+            id = kOverflowId;
+        }
+        return *table[id].load(std::memory_order_acquire);
+    }
+};
+
+// Reference-counted chunk of a per-thread message arena. Each record stored
+// in a chunk holds one reference, and so does the owning thread while the
+// chunk is still its current one.
+struct ArenaChunk {
+    std::atomic<uint32_t> refs;
+    uint32_t capacity;
+    uint32_t used;
+    char data[1];
+    
+    static ArenaChunk* create(uint32_t capacity) {
+        void* memory = ::operator new(offsetof(ArenaChunk, data) + capacity);
+        ArenaChunk* chunk = static_cast<ArenaChunk*>(memory);
+        new (&chunk->refs) std::atomic<uint32_t>(1);
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        return chunk;
+    }
+    
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ::operator delete(this);
+        }
+    }
+};
+
+// Bump allocator for long messages; one current chunk per producer thread
+class MessageArena {
+public:
+    static constexpr uint32_t kChunkSize = 64 * 1024;
+    
+    struct Slice {
+        ArenaChunk* chunk;
+        const char* data;
+        uint32_t length;
+    };
+    
+    static Slice store(std::string_view text) {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        ThreadChunk& holder = threadChunk();
+        ArenaChunk* chunk = holder.current;
+        
+        if (length > kChunkSize / 4) {
+            // Oversized message gets a dedicated chunk owned only by the record
+            chunk = ArenaChunk::create(length);
+        } else {
+            if (!chunk || chunk->capacity - chunk->used < length) {
+                if (chunk) {
+                    chunk->release();
+                }
+                chunk = holder.current = ArenaChunk::create(kChunkSize);
+            }
+            chunk->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        char* destination = chunk->data + chunk->used;
+        std::memcpy(destination, text.data(), length);
+        chunk->used += length;
+        return Slice{chunk, destination, length};
+    }
+    
+private:
+    struct ThreadChunk {
+        ArenaChunk* current = nullptr;
+        ~ThreadChunk() {
+            if (current) {
+                current->release();
+            }
+        }
+    };
+    
+    static ThreadChunk& threadChunk() {
+        thread_local ThreadChunk holder;
+        return holder;
+    }
+};
+
+// Compact, trivially copyable form of ErrorContext (one cache line) for
+// queues and ring buffers. Short messages are stored inline, long ones in the
+// producing thread's MessageArena; whoever consumes the record last must call
+// release() to drop its arena reference.
+struct CompactErrorRecord {
+    static constexpr size_t kInlineCapacity = 48;
+    static constexpr uint8_t kExternal = 0xFF;
+    
+    int64_t ticks;         // system_clock ticks since epoch
+    int32_t errorCode;
+    uint16_t componentId;  // see ComponentRegistry
+    uint8_t level;
+    uint8_t inlineLength;  // kExternal when the message lives in the arena
+    union {
+        char inlineText[kInlineCapacity];
+        MessageArena::Slice external;
+    };
+    
+    static CompactErrorRecord make(ErrorLevel level, uint16_t componentId, std::string_view message, int code = 0,
+                                   std::chrono::system_clock::time_point when = std::chrono::system_clock::now()) {
+        CompactErrorRecord record;
+        record.ticks = when.time_since_epoch().count();
+        record.errorCode = code;
+        record.componentId = componentId;
+        record.level = static_cast<uint8_t>(level);
+        if (message.size() <= kInlineCapacity) {
+            record.inlineLength = static_cast<uint8_t>(message.size());
+            std::memcpy(record.inlineText, message.data(), message.size());
+        } else {
+            record.inlineLength = kExternal;
+            record.external = MessageArena::store(message);
+        }
+        return record;
+    }
+    
+    static CompactErrorRecord make(ErrorLevel level, std::string_view component, std::string_view message, int code = 0) {
+        return make(level, ComponentRegistry::instance().intern(component), message, code);
+    }
+    
+    std::string_view message() const {
+        if (inlineLength == kExternal) {
+            return std::string_view(external.data, external.length);
+        }
+        return std::string_view(inlineText, inlineLength);
+    }
+    
+    std::string_view component() const {
+        return ComponentRegistry::instance().name(componentId);
+    }
+    
+    std::chrono::system_clock::time_point timestamp() const {
+        return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+    }
+    
+    ErrorContext toErrorContext() const {
+        ErrorContext error(static_cast<ErrorLevel>(level), std::string(message()), std::string(component()), errorCode);
+        error.timestamp = timestamp();
+        return error;
+    }
+    
+    void release() const {
+        if (inlineLength == kExternal) {
+            external.chunk->release();
+        }
+    }
+};
+
+static_assert(std::is_trivially_copyable<CompactErrorRecord>::value, "records are moved with memcpy");
+static_assert(sizeof(CompactErrorRecord) == 64, "one cache line per record");
+
+// Sub-second digits appended to formatted timestamps
+enum class TimestampPrecision {
+    SECONDS,
+    MILLISECONDS,
+    MICROSECONDS
+};
+
+// Cached timestamp formatter - the "YYYY-MM-DD HH:MM:SS" prefix is rebuilt
+// only when the second changes. The cache is per thread, so no locking, and
+// localtime_r keeps the conversion itself thread-safe.
+class TimestampFormatter {
+public:
+    static constexpr size_t kBufferSize = 32;  // prefix + ".ffffff" + NUL, with headroom
+    
+    // Writes into buffer (NUL-terminated) and returns the length, or 0 if it doesn't fit
+    static size_t format(const std::chrono::system_clock::time_point& tp, char* buffer, size_t capacity,
+                         TimestampPrecision precision = TimestampPrecision::SECONDS) {
+        using namespace std::chrono;
+        auto sinceEpoch = tp.time_since_epoch();
+        auto secs = duration_cast<seconds>(sinceEpoch);
+        auto micros = duration_cast<microseconds>(sinceEpoch - secs).count();
+        if (micros < 0) {
+            secs -= seconds(1);
+            micros += 1000000;
+        }
+        
+        SecondCache& cache = secondCache();
+        if (!cache.valid || cache.second != secs.count()) {
+            std::time_t time = static_cast<std::time_t>(secs.count());
+            std::tm local{};
+            localtime_r(&time, &local);
+            cache.length = std::strftime(cache.prefix, sizeof(cache.prefix), "%Y-%m-%d %H:%M:%S", &local);
+            cache.second = secs.count();
+            cache.valid = true;
+        }
+        
+        int digits = 0;
+        long fraction = 0;
+        if (precision == TimestampPrecision::MILLISECONDS) {
+            digits = 3;
+            fraction = static_cast<long>(micros / 1000);
+        } else if (precision == TimestampPrecision::MICROSECONDS) {
+            digits = 6;
+            fraction = static_cast<long>(micros);
+        }
+        
+        size_t length = cache.length + (digits ? digits + 1 : 0);
+        if (cache.length == 0 || length + 1 > capacity) {
+            return 0;
+        }
+        
+        std::memcpy(buffer, cache.prefix, cache.length);
+        if (digits) {
+            buffer[cache.length] = '.';
+            for (int i = digits; i > 0; --i) {
+                buffer[cache.length + i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+    
+private:
+    struct SecondCache {
+        long long second = 0;
+        bool valid = false;
+        size_t length = 0;
+        char prefix[kBufferSize] = {};
+    };
+    
+    static SecondCache& secondCache() {
+        thread_local SecondCache cache;
+        return cache;
+    }
+};
+
+inline const char* levelToString(ErrorLevel level) {
+    switch(level) {
+        case ErrorLevel::INFO: return "INFO";
+        case ErrorLevel::WARNING: return "WARNING";
+        case ErrorLevel::ERROR: return "ERROR";
+        case ErrorLevel::CRITICAL: return "CRITICAL";
+        default: return "UNKNOWN";
+    }
+}
+
+// One event as seen by the handler chain. Each output format is rendered
+// lazily on first use and then shared (immutable) by every handler that
+// asks for it, so an event is formatted once no matter how long the chain is.
+class LogRecord {
+private:
+    const ErrorContext& error;
+    TimestampPrecision precision;
+    mutable char timestamp[TimestampFormatter::kBufferSize];
+    mutable size_t timestampLength = 0;
+    mutable std::shared_ptr<const std::string> textLine;
+    mutable std::shared_ptr<const std::string> jsonLine;
+    
+    std::string_view timestampView() const {
+        if (timestampLength == 0) {
+            timestampLength = TimestampFormatter::format(error.timestamp, timestamp, sizeof(timestamp), precision);
+        }
+        return std::string_view(timestamp, timestampLength);
+    }
+    
+    static void appendCode(std::string& out, int code) {
+        char digits[16];
+        auto result = std::to_chars(digits, digits + sizeof(digits), code);
+        out.append(digits, result.ptr);
+    }
+    
+    static void appendJsonEscaped(std::string& out, std::string_view value) {
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        static const char hex[] = "0123456789abcdef";
+                        out += "\\u00";
+                        out += hex[(c >> 4) & 0xF];
+                        out += hex[c & 0xF];
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+    }
+    
+public:
+    explicit LogRecord(const ErrorContext& ctx, TimestampPrecision timestampPrecision = TimestampPrecision::SECONDS)
+        : error(ctx), precision(timestampPrecision) {}
+    
+    LogRecord(const LogRecord&) = delete;
+    LogRecord& operator=(const LogRecord&) = delete;
+    
+    const ErrorContext& context() const {
+        return error;
+    }
+    
+    TimestampPrecision timestampPrecision() const {
+        return precision;
+    }
+    
+    // "<timestamp> [LEVEL] [component] message (Code: n)", no trailing newline
+    const std::shared_ptr<const std::string>& text() const {
+        if (!textLine) {
+            std::string_view ts = timestampView();
+            const char* level = levelToString(error.level);
+            auto line = std::make_shared<std::string>();
+            line->reserve(ts.size() + std::strlen(level) + error.component.size() + error.message.size() + 32);
+            line->append(ts);
+            line->append(" [").append(level).append("] [");
+            line->append(error.component).append("] ");
+            line->append(error.message);
+            if (error.errorCode != 0) {
+                line->append(" (Code: ");
+                appendCode(*line, error.errorCode);
+                line->push_back(')');
+            }
+            textLine = std::move(line);
+        }
+        return textLine;
+    }
+    
+    // {"timestamp":...,"level":...,"component":...,"message":...,"code":n}
+    const std::shared_ptr<const std::string>& json() const {
+        if (!jsonLine) {
+            auto line = std::make_shared<std::string>();
+            line->reserve(error.component.size() + error.message.size() + 96);
+            line->append("{\"timestamp\":\"").append(timestampView());
+            line->append("\",\"level\":\"").append(levelToString(error.level));
+            line->append("\",\"component\":\"");
+            appendJsonEscaped(*line, error.component);
+            line->append("\",\"message\":\"");
+            appendJsonEscaped(*line, error.message);
+            line->append("\",\"code\":");
+            appendCode(*line, error.errorCode);
+            line->push_back('}');
+            jsonLine = std::move(line);
+        }
+        return jsonLine;
+    }
+};
+
 // Abstract error handler base class
 class ErrorHandler {
 protected:
     std::unique_ptr<ErrorHandler> nextHandler;
     ErrorLevel handlerLevel;
+
+public:
+    ErrorHandler(ErrorLevel level) : handlerLevel(level) {}
+    virtual ~ErrorHandler() = default;
+    
+    // Chain setup
+    ErrorHandler* setNext(std::unique_ptr<ErrorHandler> handler) {
+        nextHandler = std::move(handler);
+        return nextHandler.get();
+    }
+    
+    // Main handling method
+    virtual void handle(const LogRecord& record) {
+        if (canHandle(record.context())) {
+            processError(record);
+        }
+        
+        // Pass to next handler in chain
+        if (nextHandler) {
+            nextHandler->handle(record);
+        }
+    }
+    
+    virtual bool canHandle(const ErrorContext& error) {
+        return error.level >= handlerLevel;
+    }
+    
+    // Could any event at this level be handled here? Used to build the
+    // middleware's level mask, so it must not under-report.
+    virtual bool mayAccept(ErrorLevel level) const {
+        return level >= handlerLevel;
+    }
+    
+    // Bitmask (see levelBit) of levels accepted by this handler or any after it
+    unsigned acceptedLevels() const {
+        unsigned mask = 0;
+        for (ErrorLevel level : {ErrorLevel::INFO, ErrorLevel::WARNING, ErrorLevel::ERROR, ErrorLevel::CRITICAL}) {
+            if (mayAccept(level)) {
+                mask |= levelBit(level);
+            }
+        }
+        if (nextHandler) {
+            mask |= nextHandler->acceptedLevels();
+        }
+        return mask;
+    }
+    
+    // Drain any buffered output down the chain
+    virtual void flush() {
+        if (nextHandler) {
+            nextHandler->flush();
+        }
+    }
+    
+protected:
+    virtual void processError(const LogRecord& record) = 0;
+};
+
+// Console logger - handles all levels
+class ConsoleErrorHandler : public ErrorHandler {
+public:
+    ConsoleErrorHandler() : ErrorHandler(ErrorLevel::INFO) {}
+    
+protected:
+    void processError(const LogRecord& record) override {
+        std::cout << "[CONSOLE] " << *record.text() << std::endl;
+    }
+};
+
+// What the async sink does when its queue is full
+enum class OverflowPolicy {
+    BLOCK,        // producer waits for the writer to make room
+    DROP_OLDEST,  // evict the oldest queued record
+    DROP_NEWEST   // discard the incoming record
+};
+
+struct AsyncSinkOptions {
+    size_t queueCapacity = 4096;
+    size_t batchSize = 256;                   // capped at queueCapacity
+    std::chrono::milliseconds flushInterval{100};
+    // Dropping by default keeps disk I/O off the logging path; BLOCK makes a
+    // producer wait for the writer (and so for the disk) when the queue fills
+    OverflowPolicy overflow = OverflowPolicy::DROP_NEWEST;
+};
+
+// Async file sink - producers enqueue rendered lines, a background writer
+// keeps the file open and writes them out in batches (by size or by time).
+// If the file can't be opened or written, the records are counted as dropped.
+class AsyncLogSink {
+public:
+    using Line = std::shared_ptr<const std::string>;
+    
+private:
+    AsyncSinkOptions options;
+    std::ofstream logFile;
+    
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable spaceAvailable;
+    std::condition_variable batchWritten;
+    std::deque<Line> queue;
+    uint64_t enqueuedCount = 0;  // records accepted into the queue
+    uint64_t retiredCount = 0;   // records written or evicted
+    bool flushRequested = false;
+    bool stopping = false;
+    bool writeFailed = false;  // reported once, writer thread only
+    std::atomic<uint64_t> droppedCount{0};
+    
+    std::thread worker;
+    
+    void run() {
+        std::vector<Line> batch;
+        batch.reserve(options.batchSize);
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workAvailable.wait_for(lock, options.flushInterval, [this] {
+                return stopping || flushRequested || queue.size() >= options.batchSize;
+            });
+            
+            if (queue.empty()) {
+                flushRequested = false;
+                batchWritten.notify_all();
+                if (stopping) {
+                    break;
+                }
+                continue;
+            }
+            
+            while (!queue.empty() && batch.size() < options.batchSize) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            spaceAvailable.notify_all();
+            lock.unlock();
+            
+            for (const auto& line : batch) {
+                logFile.write(line->data(), static_cast<std::streamsize>(line->size()));
+                logFile.put('\n');
+            }
+            logFile.flush();
+            if (!logFile) {
+                droppedCount.fetch_add(batch.size(), std::memory_order_relaxed);
+                if (!writeFailed) {
+                    std::cerr << "AsyncLogSink: write failed, records are being dropped" << std::endl;
+                    writeFailed = true;
+                }
+                logFile.clear();
+            }
+            
+            lock.lock();
+            retiredCount += batch.size();
+            batch.clear();
+            batchWritten.notify_all();
+        }
+    }
+    
+public:
+    AsyncLogSink(const std::string& filename, AsyncSinkOptions opts = AsyncSinkOptions())
+        : options(opts), logFile(filename, std::ios::app) {
+        if (options.queueCapacity == 0) options.queueCapacity = 1;
+        if (options.batchSize == 0) options.batchSize = 1;
+        // a full queue must count as a full batch, or blocked producers wait out flushInterval
+        if (options.batchSize > options.queueCapacity) options.batchSize = options.queueCapacity;
+        if (!logFile.is_open()) {
+            std::cerr << "AsyncLogSink: cannot open " << filename << ", records will be dropped" << std::endl;
+            return;  // no writer; push() counts every record as dropped
+        }
+        worker = std::thread(&AsyncLogSink::run, this);
+    }
+    
+    ~AsyncLogSink() {
+        shutdown();
+    }
+    
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+    
+    // Returns false if the record was dropped
+    bool push(Line line) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping || !worker.joinable()) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        if (queue.size() >= options.queueCapacity) {
+            switch (options.overflow) {
+                case OverflowPolicy::BLOCK:
+                    spaceAvailable.wait(lock, [this] {
+                        return stopping || queue.size() < options.queueCapacity;
+                    });
+                    if (stopping) {
+                        droppedCount.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    break;
+                case OverflowPolicy::DROP_OLDEST:
+                    queue.pop_front();
+                    ++retiredCount;
+                    droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                case OverflowPolicy::DROP_NEWEST:
+                    droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+            }
+        }
+        
+        queue.push_back(std::move(line));
+        ++enqueuedCount;
+        if (queue.size() >= options.batchSize) {
+            workAvailable.notify_one();
+        }
+        return true;
+    }
+    
+    // Blocks until everything queued before this call is on disk
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            return;
+        }
+        uint64_t target = enqueuedCount;
+        flushRequested = true;
+        workAvailable.notify_one();
+        batchWritten.wait(lock, [this, target] { return retiredCount >= target; });
+    }
+    
+    // Drains the queue and stops the writer thread
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!worker.joinable()) {
+                return;
+            }
+            stopping = true;
+        }
+        workAvailable.notify_one();
+        spaceAvailable.notify_all();
+        worker.join();
+        logFile.flush();
+    }
+    
+    uint64_t dropped() const {
+        return droppedCount.load(std::memory_order_relaxed);
+    }
+};
+
+struct MappedLogOptions {
+    size_t segmentSize = 16 * 1024 * 1024;
+};
+
+// Memory-mapped log: lines are memcpy'd into a pre-sized, zero-filled segment
+// file (<base>.000001, <base>.000002, ...), so appends make no syscalls and a
+// tailer can read the mapping directly, stopping at the first NUL byte. Full
+// segments are trimmed to their used length and the next one is started. On
+// startup the newest untrimmed segment is recovered: anything after its last
+// complete line (a write torn by a crash) is zeroed and appends resume there.
+class MappedSegmentLog {
+private:
+    std::string basePath;
+    MappedLogOptions options;
+    unsigned segmentIndex = 0;
+    int fd = -1;
+    char* mapping = nullptr;
+    size_t used = 0;
+    size_t syncedUpTo = 0;
+    uint64_t droppedLines = 0;
+    
+    std::string segmentPath(unsigned index) const {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), ".%06u", index);
+        return basePath + suffix;
+    }
+    
+    bool mapSegment(unsigned index, bool recover) {
+        std::string path = segmentPath(index);
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            closeSegment(false);
+            return false;
+        }
+        bool resuming = recover && static_cast<size_t>(info.st_size) == options.segmentSize;
+        if (!resuming && info.st_size != 0) {
+            // Trimmed (finished) segment - never append to it
+            ::close(fd);
+            fd = -1;
+            return mapSegment(index + 1, false);
+        }
+        if (!resuming && ::ftruncate(fd, static_cast<off_t>(options.segmentSize)) != 0) {
+            closeSegment(false);
+            return false;
+        }
+        void* address = ::mmap(nullptr, options.segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            closeSegment(false);
+            return false;
+        }
+        mapping = static_cast<char*>(address);
+        segmentIndex = index;
+        used = 0;
+        
+        if (resuming) {
+            const char* end = static_cast<const char*>(std::memchr(mapping, '\0', options.segmentSize));
+            size_t written = end ? static_cast<size_t>(end - mapping) : options.segmentSize;
+            while (used < written) {
+                const char* newline = static_cast<const char*>(std::memchr(mapping + used, '\n', written - used));
+                if (!newline) {
+                    break;
+                }
+                used = static_cast<size_t>(newline - mapping) + 1;
+            }
+            std::memset(mapping + used, 0, written - used);
+        }
+        syncedUpTo = used;
+        return true;
+    }
+    
+    void closeSegment(bool trim) {
+        if (mapping) {
+            ::msync(mapping, options.segmentSize, MS_SYNC);
+            ::munmap(mapping, options.segmentSize);
+            mapping = nullptr;
+        }
+        if (fd >= 0) {
+            if (trim) {
+                (void)::ftruncate(fd, static_cast<off_t>(used));
+            }
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    
+public:
+    MappedSegmentLog(const std::string& path, MappedLogOptions opts = MappedLogOptions())
+        : basePath(path), options(opts) {
+        long pageSize = ::sysconf(_SC_PAGESIZE);
+        if (options.segmentSize < static_cast<size_t>(pageSize)) {
+            options.segmentSize = static_cast<size_t>(pageSize);
+        }
+        
+        // Resume after the newest existing segment
+        unsigned last = 0;
+        struct stat info;
+        while (::stat(segmentPath(last + 1).c_str(), &info) == 0) {
+            ++last;
+        }
+        if (!mapSegment(last == 0 ? 1 : last, last != 0)) {
+            std::cerr << "MappedSegmentLog: cannot map " << segmentPath(last == 0 ? 1 : last) << std::endl;
+        }
+    }
+    
+    ~MappedSegmentLog() {
+        // Left untrimmed on purpose: the next run resumes this segment
+        closeSegment(false);
+    }
+    
+    MappedSegmentLog(const MappedSegmentLog&) = delete;
+    MappedSegmentLog& operator=(const MappedSegmentLog&) = delete;
+    
+    bool isOpen() const {
+        return mapping != nullptr;
+    }
+    
+    // Appends line + '\n'; lines longer than a segment are truncated
+    bool append(std::string_view line) {
+        if (!mapping) {
+            ++droppedLines;
+            return false;
+        }
+        size_t length = std::min(line.size(), options.segmentSize - 1);
+        if (used + length + 1 > options.segmentSize) {
+            closeSegment(true);
+            if (!mapSegment(segmentIndex + 1, false)) {
+                ++droppedLines;
+                return false;
+            }
+        }
+        std::memcpy(mapping + used, line.data(), length);
+        mapping[used + length] = '\n';
+        used += length + 1;
+        return true;
+    }
+    
+    // Writes dirty pages back to the file (the mapping is already visible to readers)
+    void flush() {
+        if (!mapping || used == syncedUpTo) {
+            return;
+        }
+        size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t start = syncedUpTo / pageSize * pageSize;
+        ::msync(mapping + start, used - start, MS_SYNC);
+        syncedUpTo = used;
+    }
+    
+    std::string currentSegment() const {
+        return segmentPath(segmentIndex);
+    }
+    
+    uint64_t dropped() const {
+        return droppedLines;
+    }
+};
+
+// File logger - handles warnings and above. Writes through the async batched
+// sink by default, or into memory-mapped segments when given MappedLogOptions.
+class FileErrorHandler : public ErrorHandler {
+private:
+    std::string filename;
+    std::unique_ptr<AsyncLogSink> sink;
+    std::unique_ptr<MappedSegmentLog> mappedLog;
+    
+public:
+    FileErrorHandler(const std::string& file, AsyncSinkOptions options = AsyncSinkOptions())
+        : ErrorHandler(ErrorLevel::WARNING), filename(file),
+          sink(std::make_unique<AsyncLogSink>(file, options)) {}
+    
+    FileErrorHandler(const std::string& file, MappedLogOptions options)
+        : ErrorHandler(ErrorLevel::WARNING), filename(file),
+          mappedLog(std::make_unique<MappedSegmentLog>(file, options)) {}
+    
+    void flush() override {
+        if (sink) {
+            sink->flush();
+        }
+        if (mappedLog) {
+            mappedLog->flush();
+        }
+        ErrorHandler::flush();
+    }
+    
+    uint64_t droppedRecords() const {
+        return sink ? sink->dropped() : mappedLog->dropped();
+    }
+    
+protected:
+    void processError(const LogRecord& record) override {
+        if (mappedLog) {
+            mappedLog->append(*record.text());
+            return;
+        }
+        // Shares the rendered line with the console handler - no copy, no re-format
+        sink->push(record.text());
+    }
+};
+
+// Email notification - handles errors and critical only
+class EmailNotificationHandler : public ErrorHandler {
+private:
+    std::string emailAddress;
+    
+public:
+    EmailNotificationHandler(const std::string& email)
+        : ErrorHandler(ErrorLevel::ERROR), emailAddress(email) {}
+    
+protected:
+    void processError(const LogRecord& record) override {
+        const ErrorContext& error = record.context();
+        // Simulate email sending
+        std::cout << "[EMAIL] Sending alert to " << emailAddress << std::endl;
+        std::cout << "        Subject: " << levelToString(error.level) 
+                  << " in " << error.component << std::endl;
+        std::cout << "        Message: " << error.message << std::endl;
+    }
+};
+
+// Database logger - handles critical errors only
+class DatabaseErrorHandler : public ErrorHandler {
+private:
+    std::string connectionString;
+    
+public:
+    DatabaseErrorHandler(const std::string& connStr)
+        : ErrorHandler(ErrorLevel::CRITICAL), connectionString(connStr) {}
+    
+protected:
+    void processError(const LogRecord& record) override {
+        const ErrorContext& error = record.context();
+        // Simulate database logging
+        std::cout << "[DATABASE] Logging to " << connectionString << std::endl;
+        std::cout << "           Inserting critical error: " << error.message << std::endl;
+        std::cout << "           Component: " << error.component 
+                  << ", Code: " << error.errorCode << std::endl;
+    }
+};
+
+struct RateLimitOptions {
+    double eventsPerSecond = 10.0;            // token refill rate per (component, code)
+    double burst = 5.0;                       // bucket size
+    std::chrono::milliseconds window{1000};   // how often suppressed repeats are summarized
+};
+
+// Rate limiter / duplicate suppressor for the front of the chain. Keeps a
+// token bucket per (component, errorCode) in a fixed-size open-addressing
+// table; events over the limit are counted instead of forwarded, and each
+// window's suppressed repeats are collapsed into one "repeated N times" record.
+class RateLimitHandler : public ErrorHandler {
+private:
+    static constexpr size_t kTableSize = 512;  // power of two
+    static constexpr size_t kMaxProbes = 8;
+    static constexpr size_t kMessageCapacity = 96;
+    
+    struct Bucket {
+        uint64_t key = 0;
+        bool used = false;
+        ErrorLevel level = ErrorLevel::INFO;
+        int errorCode = 0;
+        uint16_t componentId = 0;
+        double tokens = 0;
+        int64_t lastRefillNs = 0;
+        int64_t windowStartNs = 0;
+        uint32_t suppressed = 0;
+        uint8_t messageLength = 0;
+        char message[kMessageCapacity];
+    };
+    
+    RateLimitOptions options;
+    int64_t windowNs;
+    Bucket table[kTableSize];
+    uint64_t suppressedTotal = 0;
+    // earliest window end among buckets holding suppressed repeats, so an
+    // event only sweeps the table once some summary is actually due
+    int64_t nextWindowEndNs = std::numeric_limits<int64_t>::max();
+    // the middleware's precision, taken from the records seen; used for summaries
+    TimestampPrecision precision = TimestampPrecision::SECONDS;
+    
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return key;
+    }
+    
+    Bucket& bucketFor(uint64_t key, int64_t nowNs) {
+        size_t index = mix(key) & (kTableSize - 1);
+        Bucket* victim = &table[index];
+        for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+            Bucket& bucket = table[(index + probe) & (kTableSize - 1)];
+            if (bucket.used && bucket.key == key) {
+                return bucket;
+            }
+            if (!bucket.used) {
+                victim = &bucket;
+                break;
+            }
+            if (bucket.lastRefillNs < victim->lastRefillNs) {
+                victim = &bucket;
+            }
+        }
+        // Reuse an empty slot or evict the least recently seen neighbour
+        if (victim->used) {
+            emitSummary(*victim);
+        }
+        victim->key = key;
+        victim->used = true;
+        victim->tokens = options.burst;
+        victim->lastRefillNs = nowNs;
+        victim->windowStartNs = nowNs;
+        victim->suppressed = 0;
+        return *victim;
+    }
+    
+    void emitSummary(Bucket& bucket) {
+        if (bucket.suppressed == 0) {
+            return;
+        }
+        uint32_t repeats = bucket.suppressed;
+        bucket.suppressed = 0;
+        if (!nextHandler) {
+            return;
+        }
+        std::string message(bucket.message, bucket.messageLength);
+        message += " (repeated " + std::to_string(repeats) + " times)";
+        ErrorContext summary(bucket.level, message,
+                             std::string(ComponentRegistry::instance().name(bucket.componentId)), bucket.errorCode);
+        LogRecord record(summary, precision);
+        nextHandler->handle(record);
+    }
+    
+    // Summarizes every window that has ended, whichever key it belongs to
+    void sweepExpired(int64_t nowNs) {
+        nextWindowEndNs = std::numeric_limits<int64_t>::max();
+        for (auto& bucket : table) {
+            if (!bucket.used || bucket.suppressed == 0) {
+                continue;
+            }
+            if (nowNs - bucket.windowStartNs >= windowNs) {
+                emitSummary(bucket);
+                bucket.windowStartNs = nowNs;
+            } else {
+                nextWindowEndNs = std::min(nextWindowEndNs, bucket.windowStartNs + windowNs);
+            }
+        }
+    }
+    
+    // True if the event should go down the chain
+    bool admit(const ErrorContext& error) {
+        int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(error.timestamp.time_since_epoch()).count();
+        if (nowNs >= nextWindowEndNs) {
+            sweepExpired(nowNs);
+        }
+        uint16_t componentId = ComponentRegistry::instance().intern(error.component);
+        uint64_t key = (static_cast<uint64_t>(componentId) << 32) | static_cast<uint32_t>(error.errorCode);
+        Bucket& bucket = bucketFor(key, nowNs);
+        
+        int64_t elapsed = std::max<int64_t>(nowNs - bucket.lastRefillNs, 0);
+        bucket.tokens = std::min(options.burst, bucket.tokens + elapsed * 1e-9 * options.eventsPerSecond);
+        bucket.lastRefillNs = std::max(bucket.lastRefillNs, nowNs);
+        
+        if (nowNs - bucket.windowStartNs >= windowNs) {
+            emitSummary(bucket);
+            bucket.windowStartNs = nowNs;
+        }
+        
+        if (bucket.tokens >= 1.0) {
+            bucket.tokens -= 1.0;
+            return true;
+        }
+        
+        if (bucket.suppressed++ == 0) {
+            // Remember what is being collapsed for the summary record
+            bucket.level = error.level;
+            bucket.errorCode = error.errorCode;
+            bucket.componentId = componentId;
+            bucket.messageLength = static_cast<uint8_t>(std::min(error.message.size(), kMessageCapacity));
+            std::memcpy(bucket.message, error.message.data(), bucket.messageLength);
+            nextWindowEndNs = std::min(nextWindowEndNs, bucket.windowStartNs + windowNs);
+        }
+        ++suppressedTotal;
+        return false;
+    }
+    
+public:
+    explicit RateLimitHandler(RateLimitOptions opts = RateLimitOptions())
+        : ErrorHandler(ErrorLevel::INFO), options(opts),
+          windowNs(std::chrono::duration_cast<std::chrono::nanoseconds>(opts.window).count()) {}
+    
+    void handle(const LogRecord& record) override {
+        precision = record.timestampPrecision();
+        if (canHandle(record.context()) && !admit(record.context())) {
+            return;
+        }
+        if (nextHandler) {
+            nextHandler->handle(record);
+        }
+    }
+    
+    // Only gates the chain; it never outputs an event itself
+    bool mayAccept(ErrorLevel) const override {
+        return false;
+    }
+    
+    // Emit summaries for repeats still pending in the current window
+    void flush() override {
+        for (auto& bucket : table) {
+            if (bucket.used) {
+                emitSummary(bucket);
+            }
+        }
+        nextWindowEndNs = std::numeric_limits<int64_t>::max();
+        ErrorHandler::flush();
+    }
+    
+    uint64_t suppressedCount() const {
+        return suppressedTotal;
+    }
+    
+protected:
+    void processError(const LogRecord&) override {}
+};
+
+// Fixed-size worker pool for retry callbacks
+class WorkerPool {
+private:
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+    
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+    
+public:
+    explicit WorkerPool(size_t threadCount) {
+        for (size_t i = 0; i < std::max<size_t>(threadCount, 1); ++i) {
+            workers.emplace_back(&WorkerPool::run, this);
+        }
+    }
+    
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskAvailable.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        taskAvailable.notify_one();
+    }
+};
+
+// Hierarchical timer wheel: 4 levels of 64 slots. Inserting is O(1), and each
+// tick touches one level-0 slot plus an occasional cascade of a higher slot,
+// so the cost per tick doesn't depend on how many timers are pending.
+template <typename Entry>
+class TimerWheel {
+public:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr uint64_t kSlots = 1ull << kSlotBits;
+    static constexpr uint64_t kMaxDelta = (1ull << (kSlotBits * kLevels)) - 1;
+    
+private:
+    struct Timer {
+        uint64_t expiry;
+        Entry entry;
+    };
+    
+    std::vector<Timer> slots[kLevels][kSlots];
+    uint64_t currentTick = 0;
+    size_t pending = 0;
+    
+    void place(Timer&& timer) {
+        if (timer.expiry <= currentTick) {
+            // Cascaded timer due this tick: the current level-0 slot is drained next
+            slots[0][currentTick & (kSlots - 1)].push_back(std::move(timer));
+            return;
+        }
+        uint64_t delta = std::min(timer.expiry - currentTick, kMaxDelta);
+        timer.expiry = currentTick + delta;
+        
+        unsigned level = 0;
+        while (level + 1 < kLevels && delta >= (1ull << (kSlotBits * (level + 1)))) {
+            ++level;
+        }
+        uint64_t index = (timer.expiry >> (kSlotBits * level)) & (kSlots - 1);
+        slots[level][index].push_back(std::move(timer));
+    }
+    
+    void cascade(unsigned level) {
+        uint64_t index = (currentTick >> (kSlotBits * level)) & (kSlots - 1);
+        std::vector<Timer> timers;
+        timers.swap(slots[level][index]);
+        for (auto& timer : timers) {
+            place(std::move(timer));
+        }
+    }
+    
+public:
+    uint64_t now() const {
+        return currentTick;
+    }
+    
+    size_t size() const {
+        return pending;
+    }
     
-    std::string formatTimestamp(const std::chrono::system_clock::time_point& tp) {
-        auto time = std::chrono::system_clock::to_time_t(tp);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
-        return ss.str();
+    void schedule(uint64_t delayTicks, Entry entry) {
+        place(Timer{currentTick + std::max<uint64_t>(delayTicks, 1), std::move(entry)});
+        ++pending;
     }
     
-    std::string levelToString(ErrorLevel level) {
-        switch(level) {
-            case ErrorLevel::INFO: return "INFO";
-            case ErrorLevel::WARNING: return "WARNING";
-            case ErrorLevel::ERROR: return "ERROR";
-            case ErrorLevel::CRITICAL: return "CRITICAL";
-            default: return "UNKNOWN";
+    // Advances to targetTick, appending every timer that expired to 'expired'
+    void advance(uint64_t targetTick, std::vector<Entry>& expired) {
+        while (currentTick < targetTick) {
+            ++currentTick;
+            for (unsigned level = 1; level < kLevels; ++level) {
+                if ((currentTick & ((1ull << (kSlotBits * level)) - 1)) != 0) {
+                    break;
+                }
+                cascade(level);
+            }
+            
+            auto& slot = slots[0][currentTick & (kSlots - 1)];
+            for (auto& timer : slot) {
+                expired.push_back(std::move(timer.entry));
+            }
+            pending -= slot.size();
+            slot.clear();
         }
     }
+};
 
+struct RetryPolicy {
+    int maxRetries = 3;
+    std::chrono::milliseconds baseDelay{50};
+    std::chrono::milliseconds maxDelay{30000};
+    double jitter = 0.2;  // +/- fraction of the backoff delay
+};
+
+struct RetryStats {
+    uint64_t scheduled = 0;     // retry timers armed (initial and follow-up)
+    uint64_t fired = 0;         // attempts executed
+    uint64_t succeeded = 0;
+    uint64_t exhausted = 0;     // gave up after maxRetries
+    uint64_t deduplicated = 0;  // rejected because the key was already pending
+};
+
+// Non-blocking retry scheduler: exponential backoff with jitter on a timer
+// wheel driven by one ticker thread; attempts run on a worker pool. A key
+// has at most one retry sequence in flight at a time.
+class RetryScheduler {
 public:
-    ErrorHandler(ErrorLevel level) : handlerLevel(level) {}
-    virtual ~ErrorHandler() = default;
+    using Attempt = std::function<bool(int attempt)>;  // true on success
     
-    // Chain setup
-    ErrorHandler* setNext(std::unique_ptr<ErrorHandler> handler) {
-        nextHandler = std::move(handler);
-        return nextHandler.get();
+private:
+    struct PendingRetry {
+        std::string key;
+        int attempt;
+        std::shared_ptr<Attempt> action;
+    };
+    
+    RetryPolicy policy;
+    std::chrono::milliseconds tickInterval;
+    std::chrono::steady_clock::time_point startTime;
+    
+    std::mutex mutex;
+    std::condition_variable idle;
+    TimerWheel<PendingRetry> wheel;
+    std::unordered_set<std::string> pendingKeys;
+    RetryStats stats;
+    bool stopping = false;
+    
+    WorkerPool pool;
+    std::thread ticker;
+    
+    uint64_t backoffTicks(int attempt) {
+        thread_local std::mt19937 rng(std::random_device{}());
+        double delay = static_cast<double>(policy.baseDelay.count()) * std::pow(2.0, attempt - 1);
+        delay = std::min(delay, static_cast<double>(policy.maxDelay.count()));
+        std::uniform_real_distribution<double> spread(1.0 - policy.jitter, 1.0 + policy.jitter);
+        delay *= spread(rng);
+        return static_cast<uint64_t>(delay / tickInterval.count()) + 1;
     }
     
-    // Main handling method
-    virtual void handle(const ErrorContext& error) {
-        if (canHandle(error)) {
-            processError(error);
-        }
-        
-        // Pass to next handler in chain
-        if (nextHandler) {
-            nextHandler->handle(error);
+    void run() {
+        std::vector<PendingRetry> expired;
+        auto nextTick = std::chrono::steady_clock::now();
+        while (true) {
+            nextTick += tickInterval;
+            std::this_thread::sleep_until(nextTick);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) {
+                    return;
+                }
+                auto elapsed = std::chrono::steady_clock::now() - startTime;
+                wheel.advance(static_cast<uint64_t>(elapsed / tickInterval), expired);
+            }
+            for (auto& retry : expired) {
+                pool.post([this, retry = std::move(retry)]() mutable { fire(std::move(retry)); });
+            }
+            expired.clear();
         }
     }
     
-    virtual bool canHandle(const ErrorContext& error) {
-        return error.level >= handlerLevel;
+    void fire(PendingRetry retry) {
+        bool succeeded = (*retry.action)(retry.attempt);
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.fired;
+        if (succeeded) {
+            ++stats.succeeded;
+        } else if (retry.attempt >= policy.maxRetries) {
+            ++stats.exhausted;
+        } else if (!stopping) {
+            ++retry.attempt;
+            ++stats.scheduled;
+            uint64_t delay = backoffTicks(retry.attempt);
+            wheel.schedule(delay, std::move(retry));
+            return;
+        }
+        pendingKeys.erase(retry.key);
+        if (pendingKeys.empty()) {
+            idle.notify_all();
+        }
     }
     
-protected:
-    virtual void processError(const ErrorContext& error) = 0;
-};
-
-// Console logger - handles all levels
-class ConsoleErrorHandler : public ErrorHandler {
 public:
-    ConsoleErrorHandler() : ErrorHandler(ErrorLevel::INFO) {}
+    explicit RetryScheduler(RetryPolicy retryPolicy = RetryPolicy(),
+                            std::chrono::milliseconds tick = std::chrono::milliseconds(10),
+                            size_t workerThreads = 2)
+        : policy(retryPolicy), tickInterval(tick), startTime(std::chrono::steady_clock::now()),
+          pool(workerThreads) {
+        ticker = std::thread(&RetryScheduler::run, this);
+    }
     
-protected:
-    void processError(const ErrorContext& error) override {
-        std::cout << "[CONSOLE] " 
-                  << formatTimestamp(error.timestamp) << " "
-                  << "[" << levelToString(error.level) << "] "
-                  << "[" << error.component << "] "
-                  << error.message;
-        
-        if (error.errorCode != 0) {
-            std::cout << " (Code: " << error.errorCode << ")";
+    ~RetryScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
-        std::cout << std::endl;
+        ticker.join();
     }
-};
-
-// File logger - handles warnings and above
-class FileErrorHandler : public ErrorHandler {
-private:
-    std::string filename;
     
-public:
-    FileErrorHandler(const std::string& file) 
-        : ErrorHandler(ErrorLevel::WARNING), filename(file) {}
+    RetryScheduler(const RetryScheduler&) = delete;
+    RetryScheduler& operator=(const RetryScheduler&) = delete;
     
-protected:
-    void processError(const ErrorContext& error) override {
-        std::ofstream logFile(filename, std::ios::app);
-        if (logFile.is_open()) {
-            logFile << formatTimestamp(error.timestamp) << " "
-                   << "[" << levelToString(error.level) << "] "
-                   << "[" << error.component << "] "
-                   << error.message;
-            
-            if (error.errorCode != 0) {
-                logFile << " (Code: " << error.errorCode << ")";
-            }
-            logFile << std::endl;
-            logFile.close();
+    // Returns false (and counts a de-duplication) if key already has a retry pending
+    bool schedule(const std::string& key, Attempt action) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || policy.maxRetries <= 0) {
+            return false;
         }
+        if (!pendingKeys.insert(key).second) {
+            ++stats.deduplicated;
+            return false;
+        }
+        ++stats.scheduled;
+        wheel.schedule(backoffTicks(1), PendingRetry{key, 1, std::make_shared<Attempt>(std::move(action))});
+        return true;
     }
-};
-
-// Email notification - handles errors and critical only
-class EmailNotificationHandler : public ErrorHandler {
-private:
-    std::string emailAddress;
     
-public:
-    EmailNotificationHandler(const std::string& email)
-        : ErrorHandler(ErrorLevel::ERROR), emailAddress(email) {}
+    // Blocks until every retry sequence has succeeded or been exhausted
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pendingKeys.empty(); });
+    }
     
-protected:
-    void processError(const ErrorContext& error) override {
-        // Simulate email sending
-        std::cout << "[EMAIL] Sending alert to " << emailAddress << std::endl;
-        std::cout << "        Subject: " << levelToString(error.level) 
-                  << " in " << error.component << std::endl;
-        std::cout << "        Message: " << error.message << std::endl;
+    // As waitIdle(), but gives up after timeout; returns false if retries remain
+    bool waitIdle(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return idle.wait_for(lock, timeout, [this] { return pendingKeys.empty(); });
     }
-};
-
-// Database logger - handles critical errors only
-class DatabaseErrorHandler : public ErrorHandler {
-private:
-    std::string connectionString;
     
-public:
-    DatabaseErrorHandler(const std::string& connStr)
-        : ErrorHandler(ErrorLevel::CRITICAL), connectionString(connStr) {}
+    RetryStats counters() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
     
-protected:
-    void processError(const ErrorContext& error) override {
-        // Simulate database logging
-        std::cout << "[DATABASE] Logging to " << connectionString << std::endl;
-        std::cout << "           Inserting critical error: " << error.message << std::endl;
-        std::cout << "           Component: " << error.component 
-                  << ", Code: " << error.errorCode << std::endl;
+    int maxRetries() const {
+        return policy.maxRetries;
     }
 };
 
@@ -170,20 +1457,151 @@ class RetryHandler : public ErrorHandler {
 private:
     int maxRetries;
     int retryableErrorCode;
+    RetryScheduler scheduler;
+    std::mutex actionsMutex;
+    std::unordered_map<std::string, std::function<bool()>> retryActions;  // by component
+    
+    static RetryPolicy policyFor(int maxRetry) {
+        RetryPolicy policy;
+        policy.maxRetries = maxRetry;
+        return policy;
+    }
     
 public:
     RetryHandler(int maxRetry = 3, int errorCode = 503)
-        : ErrorHandler(ErrorLevel::ERROR), maxRetries(maxRetry), retryableErrorCode(errorCode) {}
+        : ErrorHandler(ErrorLevel::ERROR), maxRetries(maxRetry), retryableErrorCode(errorCode),
+          scheduler(policyFor(maxRetry)) {}
     
     bool canHandle(const ErrorContext& error) override {
         return error.level >= handlerLevel && error.errorCode == retryableErrorCode;
     }
     
+    // The operation to re-run when a component reports the retryable code
+    void setRetryAction(const std::string& component, std::function<bool()> action) {
+        std::lock_guard<std::mutex> lock(actionsMutex);
+        retryActions[component] = std::move(action);
+    }
+    
+    RetryStats stats() {
+        return scheduler.counters();
+    }
+    
+    // flush() only drains output; retries may back off for up to maxDelay, so
+    // waiting for them is separate and can be bounded
+    void waitForRetries() {
+        scheduler.waitIdle();
+    }
+    
+    bool waitForRetries(std::chrono::milliseconds timeout) {
+        return scheduler.waitIdle(timeout);
+    }
+    
 protected:
-    void processError(const ErrorContext& error) override {
+    void processError(const LogRecord& record) override {
+        const ErrorContext& error = record.context();
         std::cout << "[RETRY] Error code " << error.errorCode 
                   << " is retryable. Max retries: " << maxRetries << std::endl;
-        std::cout << "        Scheduling retry for: " << error.message << std::endl;
+        
+        std::function<bool()> action;
+        {
+            std::lock_guard<std::mutex> lock(actionsMutex);
+            auto it = retryActions.find(error.component);
+            if (it != retryActions.end()) {
+                action = it->second;
+            }
+        }
+        if (!action) {
+            std::cout << "        No retry action registered for: " << error.component << std::endl;
+            return;
+        }
+        
+        std::string key = error.component + ":" + std::to_string(error.errorCode);
+        std::string component = error.component;
+        bool scheduled = scheduler.schedule(key, [action, component](int attempt) {
+            bool ok = action();
+            std::cout << "[RETRY] " << component << " attempt " << attempt
+                      << (ok ? " succeeded" : " failed") << std::endl;
+            return ok;
+        });
+        std::cout << "        " << (scheduled ? "Scheduling retry for: " : "Retry already pending for: ")
+                  << error.message << std::endl;
+    }
+};
+
+// Bounded lock-free multi-producer / single-consumer ring (per-slot sequence
+// numbers, Vyukov style). Producers claim a slot with one CAS on the tail and
+// publish it with a release store, so no mutex is taken on the hot path and
+// each producer's records come out in the order it pushed them.
+template <typename T>
+class MpscRingBuffer {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity;
+    size_t mask;
+    alignas(64) std::atomic<size_t> tail{0};  // next position producers claim
+    alignas(64) size_t head = 0;              // consumer-owned
+    
+public:
+    explicit MpscRingBuffer(size_t minCapacity) {
+        capacity = 2;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        slots.reset(new Slot[capacity]);
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    ~MpscRingBuffer() {
+        while (consume([](T&) {})) {
+        }
+    }
+    
+    MpscRingBuffer(const MpscRingBuffer&) = delete;
+    MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+    
+    // Any thread. Returns false when the ring is full.
+    template <typename... Args>
+    bool tryPush(Args&&... args) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (slot.storage) T(std::forward<Args>(args)...);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // Consumer thread only. Hands the oldest record to fn, then frees the slot.
+    template <typename Fn>
+    bool consume(Fn&& fn) {
+        Slot& slot = slots[head & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        T* item = std::launder(reinterpret_cast<T*>(slot.storage));
+        fn(*item);
+        item->~T();
+        slot.sequence.store(head + capacity, std::memory_order_release);
+        ++head;
+        return true;
     }
 };
 
@@ -191,46 +1609,282 @@ protected:
 class ErrorMiddleware {
 private:
     std::unique_ptr<ErrorHandler> handlerChain;
+    RetryHandler* retryHandler = nullptr;  // owned by the chain
+    FileErrorHandler* fileHandler = nullptr;  // owned by the chain
+    TimestampPrecision timestampPrecision = TimestampPrecision::SECONDS;
+    unsigned levelMask = 0;  // levels at least one handler accepts
+    
+    // Concurrent ingestion: producers push into the ring from any thread, a
+    // single consumer thread runs the (single-threaded) handler chain.
+    // ingestRing publishes ingestStorage to log() callers on other threads.
+    std::unique_ptr<MpscRingBuffer<CompactErrorRecord>> ingestStorage;
+    std::atomic<MpscRingBuffer<CompactErrorRecord>*> ingestRing{nullptr};
+    std::thread ingestConsumer;
+    std::atomic<bool> ingestStopping{false};
+    std::atomic<uint64_t> ingestSubmitted{0};
+    std::atomic<uint64_t> ingestProcessed{0};
+    
+    // CompactErrorRecord::level of a flush request queued by flush(); the
+    // record's inline text holds the address of the caller's done flag
+    static constexpr uint8_t kFlushRequest = 0xFF;
+    
+    void refreshLevelMask() {
+        levelMask = handlerChain ? handlerChain->acceptedLevels() : 0;
+    }
+    
+    std::unique_ptr<ErrorHandler> makeHandler(const std::string& name, const std::string& logFile) {
+        if (name == "ratelimit") {
+            return std::make_unique<RateLimitHandler>();
+        }
+        if (name == "console") {
+            return std::make_unique<ConsoleErrorHandler>();
+        }
+        if (name == "file") {
+            auto file = std::make_unique<FileErrorHandler>(logFile);
+            fileHandler = file.get();
+            return file;
+        }
+        if (name == "mmapfile") {
+            auto file = std::make_unique<FileErrorHandler>(logFile, MappedLogOptions());
+            fileHandler = file.get();
+            return file;
+        }
+        if (name == "email") {
+            return std::make_unique<EmailNotificationHandler>("admin@company.com");
+        }
+        if (name == "retry") {
+            auto retry = std::make_unique<RetryHandler>(3, 503);
+            retryHandler = retry.get();
+            return retry;
+        }
+        if (name == "database") {
+            return std::make_unique<DatabaseErrorHandler>("mongodb://localhost:27017/logs");
+        }
+        return nullptr;
+    }
+    
+    void runIngestConsumer() {
+        MpscRingBuffer<CompactErrorRecord>& ring = *ingestStorage;
+        int idleRounds = 0;
+        while (true) {
+            bool consumed = ring.consume([this](CompactErrorRecord& record) {
+                if (record.level == kFlushRequest) {
+                    // the chain is only ever touched from this thread while ingesting
+                    if (handlerChain) {
+                        handlerChain->flush();
+                    }
+                    std::atomic<bool>* done;
+                    std::memcpy(&done, record.inlineText, sizeof(done));
+                    done->store(true, std::memory_order_release);
+                    return;
+                }
+                handleError(record.toErrorContext());
+                record.release();
+            });
+            if (consumed) {
+                ingestProcessed.fetch_add(1, std::memory_order_release);
+                idleRounds = 0;
+                continue;
+            }
+            if (ingestStopping.load(std::memory_order_acquire)
+                && ingestProcessed.load(std::memory_order_relaxed) == ingestSubmitted.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (++idleRounds < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+    
     
 public:
+    ~ErrorMiddleware() {
+        stopConcurrentIngestion();
+    }
+    
+    // Switch log*() calls to the lock-free multi-producer front end
+    void startConcurrentIngestion(size_t capacity = 65536) {
+        if (ingestStorage) {
+            return;
+        }
+        ingestStopping.store(false);
+        ingestStorage = std::make_unique<MpscRingBuffer<CompactErrorRecord>>(capacity);
+        ingestConsumer = std::thread(&ErrorMiddleware::runIngestConsumer, this);
+        ingestRing.store(ingestStorage.get(), std::memory_order_release);
+    }
+    
+    // Drains everything already submitted, then returns to synchronous handling.
+    // Producers must have stopped logging before this is called: one still
+    // inside submit() would push into the ring as it is freed, and one that
+    // falls back to synchronous handling would run the chain alongside the
+    // draining consumer.
+    void stopConcurrentIngestion() {
+        if (!ingestStorage) {
+            return;
+        }
+        ingestStopping.store(true, std::memory_order_release);
+        ingestConsumer.join();
+        ingestRing.store(nullptr, std::memory_order_release);
+        ingestStorage.reset();
+    }
+    
+    // Safe from any thread while concurrent ingestion is running; spins
+    // (yielding) only if the ring is full
+    void submit(const CompactErrorRecord& record) {
+        MpscRingBuffer<CompactErrorRecord>* ring = ingestRing.load(std::memory_order_acquire);
+        ingestSubmitted.fetch_add(1, std::memory_order_release);
+        while (!ring->tryPush(record)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void setTimestampPrecision(TimestampPrecision precision) {
+        timestampPrecision = precision;
+    }
+    
     void setupChain() {
-        // Create handler chain: Console -> File -> Email -> Retry -> Database
-        auto console = std::make_unique<ConsoleErrorHandler>();
-        auto file = std::make_unique<FileErrorHandler>("application.log");
-        auto email = std::make_unique<EmailNotificationHandler>("admin@company.com");
-        auto retry = std::make_unique<RetryHandler>(3, 503);
-        auto database = std::make_unique<DatabaseErrorHandler>("mongodb://localhost:27017/logs");
+        // Create handler chain: RateLimit -> Console -> File -> Email -> Retry -> Database
+        setupChain("ratelimit,console,file,email,retry,database");
+    }
+    
+    // Builds the chain from a comma-separated list of handler names: ratelimit,
+    // console, file, mmapfile, email, retry, database. Not safe while
+    // concurrent ingestion is running.
+    void setupChain(const std::string& spec, const std::string& logFile = "application.log") {
+        std::unique_ptr<ErrorHandler> head;
+        ErrorHandler* tail = nullptr;
+        retryHandler = nullptr;
+        fileHandler = nullptr;
         
-        // Chain them together
-        console->setNext(std::move(file))
-               ->setNext(std::move(email))
-               ->setNext(std::move(retry))
-               ->setNext(std::move(database));
+        size_t begin = 0;
+        while (begin <= spec.size()) {
+            size_t end = spec.find(',', begin);
+            if (end == std::string::npos) {
+                end = spec.size();
+            }
+            std::string name = spec.substr(begin, end - begin);
+            begin = end + 1;
+            
+            std::unique_ptr<ErrorHandler> handler = makeHandler(name, logFile);
+            if (!handler) {
+                if (!name.empty()) {
+                    std::cerr << "Unknown error handler: " << name << std::endl;
+                }
+                continue;
+            }
+            
+            // Chain them together
+            ErrorHandler* added = handler.get();
+            if (tail) {
+                tail->setNext(std::move(handler));
+            } else {
+                head = std::move(handler);
+            }
+            tail = added;
+        }
         
-        handlerChain = std::move(console);
+        handlerChain = std::move(head);
+        refreshLevelMask();
+    }
+    
+    void setRetryAction(const std::string& component, std::function<bool()> action) {
+        if (retryHandler) {
+            retryHandler->setRetryAction(component, std::move(action));
+        }
+    }
+    
+    RetryStats retryStats() {
+        return retryHandler ? retryHandler->stats() : RetryStats();
+    }
+    
+    // Blocks until every scheduled retry has succeeded or been exhausted
+    void waitForRetries() {
+        if (retryHandler) {
+            retryHandler->waitForRetries();
+        }
+    }
+    
+    // Returns false if retries are still pending after timeout
+    bool waitForRetries(std::chrono::milliseconds timeout) {
+        return retryHandler ? retryHandler->waitForRetries(timeout) : true;
+    }
+    
+    // records the file handler's sink could not write (queue full or I/O error)
+    uint64_t droppedFileRecords() const {
+        return fileHandler ? fileHandler->droppedRecords() : 0;
+    }
+    
+    // One branch, no allocation, for levels nobody in the chain would accept
+    bool isEnabled(ErrorLevel level) const {
+        return (levelMask & levelBit(level)) != 0;
     }
     
     void handleError(const ErrorContext& error) {
+        if (isEnabled(error.level)) {
+            LogRecord record(error, timestampPrecision);
+            handlerChain->handle(record);
+        }
+    }
+    
+    // Levels below kMinCompiledLevel compile to nothing; otherwise the
+    // strings are only materialized once the level mask says someone listens
+    template <ErrorLevel Level>
+    void log(std::string_view component, std::string_view message, int code = 0) {
+        if constexpr (Level >= kMinCompiledLevel) {
+            if (!isEnabled(Level)) {
+                return;
+            }
+            // ingestRing is only swapped by start/stopConcurrentIngestion, which
+            // require that no other thread is logging at the time
+            if (ingestRing.load(std::memory_order_acquire) != nullptr
+                && !ingestStopping.load(std::memory_order_relaxed)) {
+                // Producer side stays allocation-free for interned components and short messages
+                submit(CompactErrorRecord::make(Level, component, message, code));
+            } else {
+                handleError(ErrorContext(Level, std::string(message), std::string(component), code));
+            }
+        }
+    }
+    
+    // Wait for buffered handlers (e.g. the async file sink) to drain. While
+    // ingesting, the flush is queued behind this thread's earlier records and
+    // run by the consumer, so producers may keep logging meanwhile.
+    void flush() {
+        if (ingestRing.load(std::memory_order_acquire) != nullptr) {
+            std::atomic<bool> done{false};
+            std::atomic<bool>* flag = &done;
+            CompactErrorRecord request{};
+            request.level = kFlushRequest;
+            request.inlineLength = 0;
+            std::memcpy(request.inlineText, &flag, sizeof(flag));
+            submit(request);
+            while (!done.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            return;
+        }
         if (handlerChain) {
-            handlerChain->handle(error);
+            handlerChain->flush();
         }
     }
     
     // Convenience methods for different error types
-    void logInfo(const std::string& component, const std::string& message) {
-        handleError(ErrorContext(ErrorLevel::INFO, message, component));
+    void logInfo(std::string_view component, std::string_view message) {
+        log<ErrorLevel::INFO>(component, message);
     }
     
-    void logWarning(const std::string& component, const std::string& message, int code = 0) {
-        handleError(ErrorContext(ErrorLevel::WARNING, message, component, code));
+    void logWarning(std::string_view component, std::string_view message, int code = 0) {
+        log<ErrorLevel::WARNING>(component, message, code);
     }
     
-    void logError(const std::string& component, const std::string& message, int code = 0) {
-        handleError(ErrorContext(ErrorLevel::ERROR, message, component, code));
+    void logError(std::string_view component, std::string_view message, int code = 0) {
+        log<ErrorLevel::ERROR>(component, message, code);
     }
     
-    void logCritical(const std::string& component, const std::string& message, int code = 0) {
-        handleError(ErrorContext(ErrorLevel::CRITICAL, message, component, code));
+    void logCritical(std::string_view component, std::string_view message, int code = 0) {
+        log<ErrorLevel::CRITICAL>(component, message, code);
     }
 };
 
@@ -267,14 +1921,298 @@ public:
     }
 };
 
+// Mutex-guarded baseline for the ingestion benchmark
+class MutexIngestQueue {
+private:
+    std::mutex mutex;
+    std::deque<ErrorContext> queue;
+    size_t capacity;
+    
+public:
+    explicit MutexIngestQueue(size_t cap) : capacity(cap) {}
+    
+    bool tryPush(ErrorContext&& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.size() >= capacity) {
+            return false;
+        }
+        queue.push_back(std::move(error));
+        return true;
+    }
+    
+    template <typename Fn>
+    bool consume(Fn&& fn) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.empty()) {
+            return false;
+        }
+        ErrorContext error = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        fn(error);
+        return true;
+    }
+};
+
+inline int benchCode(const ErrorContext& error) { return error.errorCode; }
+inline int benchCode(const CompactErrorRecord& record) { return record.errorCode; }
+inline void benchRelease(const ErrorContext&) {}
+inline void benchRelease(const CompactErrorRecord& record) { record.release(); }
+
+// Producers push records tagged (producer, sequence) through errorCode; the
+// consumer checks per-producer ordering and discards them. Returns events/sec.
+template <typename Record, typename Queue>
+double runIngestionBenchmark(Queue& queue, int producers, int eventsPerProducer, bool& ordered) {
+    std::vector<int> lastSeen(producers, -1);
+    uint64_t total = static_cast<uint64_t>(producers) * eventsPerProducer;
+    ordered = true;
+    
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        uint64_t received = 0;
+        while (received < total) {
+            bool got = queue.consume([&](Record& record) {
+                int producer = benchCode(record) / eventsPerProducer;
+                int sequence = benchCode(record) % eventsPerProducer;
+                if (sequence != lastSeen[producer] + 1) {
+                    ordered = false;
+                }
+                lastSeen[producer] = sequence;
+                benchRelease(record);
+            });
+            if (got) {
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p, eventsPerProducer] {
+            for (int i = 0; i < eventsPerProducer; ++i) {
+                int code = p * eventsPerProducer + i;
+                if constexpr (std::is_same<Record, CompactErrorRecord>::value) {
+                    CompactErrorRecord record = CompactErrorRecord::make(ErrorLevel::ERROR, "WebService",
+                                                                         "Service temporarily unavailable", code);
+                    while (!queue.tryPush(record)) {
+                        std::this_thread::yield();
+                    }
+                } else {
+                    ErrorContext error(ErrorLevel::ERROR, "Service temporarily unavailable", "WebService", code);
+                    while (!queue.tryPush(std::move(error))) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    consumer.join();
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return total / elapsed.count();
+}
+
+void benchmarkIngestion(int totalEvents = 400000) {
+    std::cout << "=== Ingestion Benchmark (" << totalEvents << " events) ===" << std::endl;
+    std::cout << "threads  compact ring (ev/s)  context ring (ev/s)  mutex deque (ev/s)  ordered" << std::endl;
+    for (int producers : {1, 4, 16, 64}) {
+        int perProducer = totalEvents / producers;
+        bool compactOrdered = false;
+        bool ringOrdered = false;
+        bool mutexOrdered = false;
+        
+        MpscRingBuffer<CompactErrorRecord> compact(65536);
+        double compactRate = runIngestionBenchmark<CompactErrorRecord>(compact, producers, perProducer, compactOrdered);
+        MpscRingBuffer<ErrorContext> ring(65536);
+        double ringRate = runIngestionBenchmark<ErrorContext>(ring, producers, perProducer, ringOrdered);
+        MutexIngestQueue locked(65536);
+        double mutexRate = runIngestionBenchmark<ErrorContext>(locked, producers, perProducer, mutexOrdered);
+        
+        std::cout << std::setw(7) << producers << "  "
+                  << std::setw(19) << static_cast<uint64_t>(compactRate) << "  "
+                  << std::setw(19) << static_cast<uint64_t>(ringRate) << "  "
+                  << std::setw(18) << static_cast<uint64_t>(mutexRate) << "  "
+                  << ((compactOrdered && ringOrdered && mutexOrdered) ? "yes" : "NO") << std::endl;
+    }
+}
+
+struct BenchmarkConfig {
+    uint64_t events = 200000;
+    int threads = 1;
+    size_t messageSize = 48;
+    unsigned levelMix[4] = {70, 20, 9, 1};  // INFO, WARNING, ERROR, CRITICAL weights
+    std::string chain = "console,file,email,retry,database";
+    bool nullOutput = true;
+    
+    // key=value arguments: events, threads, message, mix=a,b,c,d, chain=..., output=null|console
+    bool parse(int argc, char* argv[], int first) {
+        for (int i = first; i < argc; ++i) {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "Expected key=value, got: " << arg << std::endl;
+                return false;
+            }
+            std::string key = arg.substr(0, eq);
+            std::string value = arg.substr(eq + 1);
+            if (key == "events") {
+                events = std::stoull(value);
+            } else if (key == "threads") {
+                threads = std::max(1, std::stoi(value));
+            } else if (key == "message") {
+                messageSize = std::stoul(value);
+            } else if (key == "chain") {
+                chain = value;
+            } else if (key == "output") {
+                nullOutput = value != "console";
+            } else if (key == "mix") {
+                if (std::sscanf(value.c_str(), "%u,%u,%u,%u", &levelMix[0], &levelMix[1], &levelMix[2], &levelMix[3]) != 4) {
+                    std::cerr << "mix expects four weights: INFO,WARNING,ERROR,CRITICAL" << std::endl;
+                    return false;
+                }
+            } else {
+                std::cerr << "Unknown benchmark option: " << key << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Drives ErrorMiddleware with the configured chain, level mix, message size
+// and thread count. With more than one thread the events go through the
+// concurrent ingestion front end. Latency is per log call on the calling
+// thread; allocations are counted across every thread, including the
+// ingestion consumer that runs the chain when threads > 1.
+void runMiddlewareBenchmark(const BenchmarkConfig& config) {
+    // Deterministic level sequence following the mix
+    std::vector<ErrorLevel> levels;
+    const ErrorLevel order[4] = {ErrorLevel::INFO, ErrorLevel::WARNING, ErrorLevel::ERROR, ErrorLevel::CRITICAL};
+    for (int l = 0; l < 4; ++l) {
+        levels.insert(levels.end(), config.levelMix[l], order[l]);
+    }
+    if (levels.empty()) {
+        levels.push_back(ErrorLevel::ERROR);
+    }
+    std::shuffle(levels.begin(), levels.end(), std::mt19937(42));
+    
+    const std::string message(config.messageSize, 'm');
+    const char* components[] = {"DatabaseService", "WebService", "PaymentService", "Security"};
+    const int codes[] = {0, 101, 503, 500};
+    
+    ErrorMiddleware middleware;
+    middleware.setupChain(config.chain, "benchmark.log");
+    
+    uint64_t perThread = config.events / config.threads;
+    std::vector<std::vector<uint32_t>> latencies(config.threads);
+    
+    std::unique_ptr<ScopedNullOutput> silence;
+    if (config.nullOutput) {
+        silence = std::make_unique<ScopedNullOutput>(std::cout);
+    }
+    if (config.threads > 1) {
+        middleware.startConcurrentIngestion();
+    }
+    
+    uint64_t allocationsBefore = allocationCount();
+    auto start = std::chrono::steady_clock::now();
+    auto worker = [&](int t) {
+        std::vector<uint32_t>& samples = latencies[t];
+        samples.reserve(perThread);
+        for (uint64_t i = 0; i < perThread; ++i) {
+            ErrorLevel level = levels[(i + t) % levels.size()];
+            const char* component = components[i % 4];
+            int code = codes[(i >> 2) % 4];
+            
+            auto begin = std::chrono::steady_clock::now();
+            switch (level) {
+                case ErrorLevel::INFO: middleware.logInfo(component, message); break;
+                case ErrorLevel::WARNING: middleware.logWarning(component, message, code); break;
+                case ErrorLevel::ERROR: middleware.logError(component, message, code); break;
+                case ErrorLevel::CRITICAL: middleware.logCritical(component, message, code); break;
+            }
+            auto elapsed = std::chrono::steady_clock::now() - begin;
+            samples.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    };
+    
+    if (config.threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < config.threads; ++t) {
+            threads.emplace_back(worker, t);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    middleware.flush();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    middleware.stopConcurrentIngestion();
+    uint64_t totalAllocations = allocationCount() - allocationsBefore;
+    silence.reset();
+    
+    std::vector<uint32_t> all;
+    for (int t = 0; t < config.threads; ++t) {
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) -> uint32_t {
+        if (all.empty()) {
+            return 0;
+        }
+        return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+    };
+    uint64_t total = all.size();
+    
+    std::cout << "=== ErrorMiddleware Benchmark ===" << std::endl;
+    std::cout << "chain: " << config.chain << ", threads: " << config.threads
+              << ", events: " << total << ", message: " << config.messageSize << " bytes"
+              << ", mix: " << config.levelMix[0] << "/" << config.levelMix[1] << "/"
+              << config.levelMix[2] << "/" << config.levelMix[3] << std::endl;
+    std::cout << "events/sec:        " << static_cast<uint64_t>(total / elapsed.count()) << std::endl;
+    std::cout << "latency p50 (ns):  " << percentile(0.50) << std::endl;
+    std::cout << "latency p99 (ns):  " << percentile(0.99) << std::endl;
+    std::cout << "latency p999 (ns): " << percentile(0.999) << std::endl;
+    std::cout << "allocations/event: " << std::fixed << std::setprecision(2)
+              << (total ? static_cast<double>(totalAllocations) / total : 0.0) << std::endl;
+    std::cout << "file records dropped: " << middleware.droppedFileRecords() << std::endl;
+}
+
 // Demo application
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-ingest") {
+        benchmarkIngestion();
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench") {
+        BenchmarkConfig config;
+        if (!config.parse(argc, argv, 2)) {
+            return 1;
+        }
+        runMiddlewareBenchmark(config);
+        return 0;
+    }
+    
     std::cout << "=== Error Handling Middleware Demo ===" << std::endl << std::endl;
     
     // Setup error handling middleware
     ErrorMiddleware errorMiddleware;
     errorMiddleware.setupChain();
     
+    // Reconnects succeed on the second attempt, payments never recover and the
+    // web service recovers at once (its repeated 503s collapse into one retry)
+    std::atomic<int> reconnects{0};
+    errorMiddleware.setRetryAction("DatabaseService", [&reconnects] { return ++reconnects >= 2; });
+    errorMiddleware.setRetryAction("PaymentService", [] { return false; });
+    errorMiddleware.setRetryAction("WebService", [] { return true; });
+    
     // Create application services
     DatabaseService dbService(errorMiddleware);
     WebService webService(errorMiddleware);
@@ -291,11 +2229,43 @@ int main() {
     dbService.performCriticalOperation();
     std::cout << std::endl;
     
+    std::cout << "--- Concurrent Logging ---" << std::endl;
+    errorMiddleware.startConcurrentIngestion();
+    {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 2; ++i) {
+            workers.emplace_back([&webService] { webService.handleRequest(); });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    errorMiddleware.stopConcurrentIngestion();
+    std::cout << std::endl;
+    
+    std::cout << "--- Error Storm (rate limited) ---" << std::endl;
+    for (int i = 0; i < 200; ++i) {
+        errorMiddleware.logError("WebService", "Service temporarily unavailable", 503);
+    }
+    errorMiddleware.flush();  // the storm is over: summarize its window now
+    std::cout << std::endl;
+    
     std::cout << "--- Manual Error Logging ---" << std::endl;
     errorMiddleware.logInfo("Application", "Application started successfully");
     errorMiddleware.logWarning("Security", "Multiple failed login attempts", 401);
     errorMiddleware.logError("PaymentService", "Payment gateway timeout", 503);
     errorMiddleware.logCritical("System", "Disk space critically low", 507);
     
+    errorMiddleware.flush();
+    if (!errorMiddleware.waitForRetries(std::chrono::seconds(10))) {
+        std::cout << "Retries still pending after 10 s" << std::endl;
+    }
+    
+    RetryStats retries = errorMiddleware.retryStats();
+    std::cout << std::endl << "--- Retry Statistics ---" << std::endl;
+    std::cout << "Scheduled: " << retries.scheduled << ", Fired: " << retries.fired
+              << ", Succeeded: " << retries.succeeded << ", Exhausted: " << retries.exhausted
+              << ", De-duplicated: " << retries.deduplicated << std::endl;
+    
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+// Shared helpers for the --bench modes of the pattern demos.
+//
+// Including this header replaces the global operator new/delete with versions
+// that count every allocation made by any thread, so include it from exactly
+// one translation unit per program (each demo is a single file). Build with
+// -DBENCH_NO_ALLOC_HOOK to leave operator new alone.
+#ifndef BENCH_SUPPORT_H
+#define BENCH_SUPPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <streambuf>
+
+inline std::atomic<uint64_t> benchAllocationCounter{0};
+
+// allocations made by all threads since program start
+inline uint64_t allocationCount() {
+    return benchAllocationCounter.load(std::memory_order_relaxed);
+}
+
+#ifndef BENCH_NO_ALLOC_HOOK
+// All out of line: GCC otherwise pairs an inlined malloc()/free() with the
+// opposite operator and reports -Wmismatched-new-delete.
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void* operator new(size_t size) {
+    benchAllocationCounter.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+BENCH_NOINLINE void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+BENCH_NOINLINE void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+BENCH_NOINLINE void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+BENCH_NOINLINE void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+#endif
+
+// Discards everything written to it; swapped into std::cout for benchmarks
+class NullStreamBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Redirects a stream to a null sink for the lifetime of the object
+class ScopedNullOutput {
+private:
+    std::ostream& stream;
+    NullStreamBuffer nullBuffer;
+    std::streambuf* saved;
+
+public:
+    explicit ScopedNullOutput(std::ostream& out) : stream(out), saved(out.rdbuf(&nullBuffer)) {}
+    ~ScopedNullOutput() {
+        stream.rdbuf(saved);
+    }
+
+    ScopedNullOutput(const ScopedNullOutput&) = delete;
+    ScopedNullOutput& operator=(const ScopedNullOutput&) = delete;
+};
+
+#endif // BENCH_SUPPORT_H
@@ -1,26 +1,450 @@
 #include<iostream>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<atomic>
+#include<chrono>
+#include<random>
+#include<string_view>
+#include<memory>
+#include<cstring>
+#include<cstdlib>
+#include<new>
+#include<type_traits>
+#include<cassert>
+#include "bench_support.h"
+
+
+// append-only storage for long descriptions, shared by the reports of one
+// batch (or one router's working set). Text stays valid until reset() or the
+// arena's destruction, so reports just keep a view; reset() hands the memory
+// back for the next batch instead of letting it grow for the process lifetime.
+class DescriptionArena {
+    private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<std::unique_ptr<char[]>> oversized;
+    size_t current = 0;       // block being filled; later blocks are spare after a reset
+    size_t used = kBlockSize; // bytes used in blocks[current]
+
+    public:
+    DescriptionArena() = default;
+    DescriptionArena(const DescriptionArena&) = delete;
+    DescriptionArena& operator=(const DescriptionArena&) = delete;
+
+    // invalidates every view handed out so far; the blocks are kept and
+    // refilled, so a reused arena stops allocating once it has seen its
+    // largest batch. Oversized text is freed.
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        oversized.clear();
+        current = 0;
+        used = blocks.empty() ? kBlockSize : 0;
+    }
+
+    size_t blockCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return blocks.size() + oversized.size();
+    }
+
+    std::string_view store(std::string_view text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(text.size() > kBlockSize / 4) {
+            // oversized text gets its own block, keeping the current one open
+            oversized.emplace_back(new char[text.size()]);
+            std::memcpy(oversized.back().get(), text.data(), text.size());
+            return std::string_view(oversized.back().get(), text.size());
+        }
+        if(used + text.size() > kBlockSize) {
+            if(!blocks.empty()) {
+                ++current;
+            }
+            if(current == blocks.size()) {
+                blocks.emplace_back(new char[kBlockSize]);
+            }
+            used = 0;
+        }
+        char* destination = blocks[current].get() + used;
+        std::memcpy(destination, text.data(), text.size());
+        used += text.size();
+        return std::string_view(destination, text.size());
+    }
+};
 
 
 class ExpenseReport {
     private:
+    static constexpr size_t kInlineCapacity = 22;
     int amount; 
-    std::string description; 
+    unsigned int length;
+    bool inlined;
+    union {
+        char inlineText[kInlineCapacity]; // short descriptions live in the report
+        const char* external;             // long ones in a DescriptionArena
+    };
      public:
-    ExpenseReport(int amt, const std::string& desc) : amount(amt), description(desc) {}
+    static constexpr size_t kMaxInlineDescription = kInlineCapacity;
+
+    // for descriptions of up to kMaxInlineDescription characters, which need
+    // no arena; longer text is a programming error (truncated under NDEBUG)
+    ExpenseReport(int amt, std::string_view desc)
+        : amount(amt), length(static_cast<unsigned int>(std::min(desc.size(), kInlineCapacity))), inlined(true) {
+        assert(desc.size() <= kInlineCapacity && "long description: pass a DescriptionArena");
+        std::memcpy(inlineText, desc.data(), length);
+    }
+    // the arena must outlive the report (or its next reset())
+    ExpenseReport(int amt, std::string_view desc, DescriptionArena& arena)
+        : amount(amt), length(static_cast<unsigned int>(desc.size())), inlined(desc.size() <= kInlineCapacity) {
+        if(inlined) {
+            std::memcpy(inlineText, desc.data(), desc.size());
+        } else {
+            external = arena.store(desc).data();
+        }
+    }
     int getAmount() const {
         return amount;
     }
-    std::string getDescription() const {
-        return description;
+    std::string_view getDescription() const {
+        return std::string_view(inlined ? inlineText : external, length);
+    }
+};
+
+// copies and moves are a plain memcpy, never an allocation
+static_assert(std::is_trivially_copyable<ExpenseReport>::value, "ExpenseReport must stay trivially copyable");
+
+
+// optional instrumentation: build with -DAPPROVAL_INSTRUMENTATION to record
+// hops per report, time in each approver's process() and approvals per
+// approver title, plus ApprovalRouter's per-report and per-batch routing
+// time. Without it the hooks below expand to nothing.
+#ifdef APPROVAL_INSTRUMENTATION
+
+// log-linear (HDR-style) histogram: 16 sub-buckets per power of two, so any
+// value is bucketed within ~6%. Written only by its owning thread.
+class LatencyHistogram {
+    public:
+    static constexpr int kSubBuckets = 16;
+    static constexpr int kBuckets = (64 - 3) * kSubBuckets;
+
+    static int bucketFor(uint64_t value) {
+        if(value < kSubBuckets) {
+            return static_cast<int>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        int sub = static_cast<int>((value >> (exponent - 4)) & (kSubBuckets - 1));
+        return (exponent - 3) * kSubBuckets + sub;
+    }
+
+    static uint64_t lowerBound(int bucket) {
+        if(bucket < kSubBuckets) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int exponent = bucket / kSubBuckets + 3;
+        return static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << (exponent - 4);
+    }
+
+    void record(uint64_t value) {
+        // single writer: a relaxed load/store pair instead of a locked RMW
+        std::atomic<uint64_t>& bucket = buckets[bucketFor(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void mergeInto(std::vector<uint64_t>& totals) const {
+        totals.resize(kBuckets);
+        for(int i = 0; i < kBuckets; ++i) {
+            totals[i] += buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    private:
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+};
+
+struct HistogramSnapshot {
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+
+    uint64_t percentile(double p) const {
+        if(count == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for(size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if(seen >= rank) {
+                return LatencyHistogram::lowerBound(static_cast<int>(i));
+            }
+        }
+        return 0;
+    }
+};
+
+struct ApproverSnapshot {
+    const char* name;
+    uint64_t approvals;
+    HistogramSnapshot processNs; // exclusive of downstream approvers
+};
+
+struct ApprovalSnapshot {
+    HistogramSnapshot hops;
+    std::vector<ApproverSnapshot> approvers;
+    HistogramSnapshot routeNs;  // ApprovalRouter::process, per report
+    HistogramSnapshot batchNs;  // ApprovalRouter::routeBatch, per batch
+    uint64_t batchReports = 0;
+};
+
+// per-thread stats registered in a global list; recording never locks,
+// snapshot() merges every thread's histograms on demand. Approvers are
+// series by title, so every Manager instance feeds the "Manager" series;
+// titles beyond the first kMaxApprovers - 1 share the "other" series.
+class ApprovalMetrics {
+    public:
+    static constexpr int kMaxApprovers = 8;
+    static constexpr int kOtherSlot = kMaxApprovers - 1;
+
+    struct ThreadStats {
+        LatencyHistogram hops;
+        LatencyHistogram processNs[kMaxApprovers];
+        std::atomic<uint64_t> approvals[kMaxApprovers] = {};
+        LatencyHistogram routeNs;
+        LatencyHistogram batchNs;
+        std::atomic<uint64_t> batchReports{0};
+    };
+
+    static ThreadStats& local() {
+        thread_local std::shared_ptr<ThreadStats> stats = registerThread();
+        return *stats;
+    }
+
+    // lazily resolves an approver's title to its slot the first time the
+    // instance records anything; id caches the result per instance
+    static int slotFor(std::atomic<int>& id, const char* name) {
+        int slot = id.load(std::memory_order_acquire);
+        if(slot >= 0) {
+            return slot;
+        }
+        if(name == nullptr) {
+            name = "untitled";
+        }
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        slot = id.load(std::memory_order_relaxed);
+        if(slot < 0) {
+            slot = kOtherSlot;
+            for(int i = 0; i < r.approverCount; ++i) {
+                if(std::strcmp(r.names[i], name) == 0) {
+                    slot = i;
+                    break;
+                }
+            }
+            if(slot == kOtherSlot && r.approverCount < kOtherSlot) {
+                slot = r.approverCount;
+                r.names[r.approverCount++] = name;
+            }
+            if(slot == kOtherSlot) {
+                r.otherUsed = true;
+            }
+            id.store(slot, std::memory_order_release);
+        }
+        return slot;
+    }
+
+    static void countApproval(std::atomic<int>& id, const char* name) {
+        std::atomic<uint64_t>& counter = local().approvals[slotFor(id, name)];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void countBatch(size_t reports) {
+        std::atomic<uint64_t>& counter = local().batchReports;
+        counter.store(counter.load(std::memory_order_relaxed) + reports, std::memory_order_relaxed);
+    }
+
+    static ApprovalSnapshot snapshot() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        ApprovalSnapshot result;
+        std::vector<int> slots;
+        for(int a = 0; a < r.approverCount; ++a) {
+            slots.push_back(a);
+        }
+        if(r.otherUsed) {
+            slots.push_back(kOtherSlot);
+        }
+        result.approvers.resize(slots.size());
+        for(size_t a = 0; a < slots.size(); ++a) {
+            result.approvers[a].name = slots[a] == kOtherSlot ? "other" : r.names[slots[a]];
+            result.approvers[a].approvals = 0;
+        }
+        for(const auto& stats : r.threads) {
+            stats->hops.mergeInto(result.hops.buckets);
+            for(size_t a = 0; a < slots.size(); ++a) {
+                stats->processNs[slots[a]].mergeInto(result.approvers[a].processNs.buckets);
+                result.approvers[a].approvals += stats->approvals[slots[a]].load(std::memory_order_relaxed);
+            }
+            stats->routeNs.mergeInto(result.routeNs.buckets);
+            stats->batchNs.mergeInto(result.batchNs.buckets);
+            result.batchReports += stats->batchReports.load(std::memory_order_relaxed);
+        }
+        auto total = [](HistogramSnapshot& h) {
+            for(uint64_t n : h.buckets) {
+                h.count += n;
+            }
+        };
+        total(result.hops);
+        for(auto& approver : result.approvers) {
+            total(approver.processNs);
+        }
+        total(result.routeNs);
+        total(result.batchNs);
+        return result;
+    }
+
+    // one "name value" line per metric, easy to scrape
+    static void print(std::ostream& out) {
+        ApprovalSnapshot snap = snapshot();
+        out << "approval_reports " << snap.hops.count << std::endl;
+        out << "approval_hops_p50 " << snap.hops.percentile(0.50) << std::endl;
+        out << "approval_hops_max " << snap.hops.percentile(1.0) << std::endl;
+        for(const auto& approver : snap.approvers) {
+            out << "approver_approvals{approver=\"" << approver.name << "\"} " << approver.approvals << std::endl;
+            out << "approver_process_ns_p50{approver=\"" << approver.name << "\"} " << approver.processNs.percentile(0.50) << std::endl;
+            out << "approver_process_ns_p99{approver=\"" << approver.name << "\"} " << approver.processNs.percentile(0.99) << std::endl;
+        }
+        out << "router_reports " << snap.routeNs.count << std::endl;
+        out << "router_route_ns_p50 " << snap.routeNs.percentile(0.50) << std::endl;
+        out << "router_route_ns_p99 " << snap.routeNs.percentile(0.99) << std::endl;
+        out << "router_batches " << snap.batchNs.count << std::endl;
+        out << "router_batch_reports " << snap.batchReports << std::endl;
+        out << "router_batch_ns_p50 " << snap.batchNs.percentile(0.50) << std::endl;
+    }
+
+    private:
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadStats>> threads; // kept after threads exit
+        const char* names[kMaxApprovers] = {};
+        int approverCount = 0;  // named slots in use, at most kOtherSlot
+        bool otherUsed = false;
+    };
+
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    static std::shared_ptr<ThreadStats> registerThread() {
+        auto stats = std::make_shared<ThreadStats>();
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(stats);
+        return stats;
+    }
+};
+
+// times one approver's process() excluding the approvers it hands off to,
+// and records the hop count when the outermost approver returns
+class ApprovalHopScope {
+    private:
+    static thread_local int depth;
+    static thread_local int hops;
+    static thread_local uint64_t childNs;
+
+    int slot;
+    uint64_t savedChildNs;
+    std::chrono::steady_clock::time_point start;
+
+    public:
+    ApprovalHopScope(std::atomic<int>& id, const char* name)
+        : slot(ApprovalMetrics::slotFor(id, name)), savedChildNs(childNs), start(std::chrono::steady_clock::now()) {
+        childNs = 0;
+        ++depth;
+        ++hops;
+    }
+
+    ~ApprovalHopScope() {
+        uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        ApprovalMetrics::ThreadStats& stats = ApprovalMetrics::local();
+        stats.processNs[slot].record(total - std::min(total, childNs));
+        childNs = savedChildNs + total;
+        if(--depth == 0) {
+            stats.hops.record(static_cast<uint64_t>(hops));
+            hops = 0;
+            childNs = 0;
+        }
+    }
+};
+
+thread_local int ApprovalHopScope::depth = 0;
+thread_local int ApprovalHopScope::hops = 0;
+thread_local uint64_t ApprovalHopScope::childNs = 0;
+
+// records the time until the end of the enclosing scope into one histogram
+class ApprovalTimerScope {
+    private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+
+    public:
+    explicit ApprovalTimerScope(LatencyHistogram& target)
+        : histogram(target), start(std::chrono::steady_clock::now()) {}
+
+    ~ApprovalTimerScope() {
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
     }
 };
 
+#define APPROVAL_METRICS_ID mutable std::atomic<int> metricsId{-1};
+#define APPROVAL_HOP_SCOPE() ApprovalHopScope approvalHopScope(metricsId, title())
+#define APPROVAL_COUNT() ApprovalMetrics::countApproval(metricsId, title())
+#define APPROVAL_ROUTE_SCOPE() ApprovalTimerScope approvalRouteScope(ApprovalMetrics::local().routeNs)
+#define APPROVAL_BATCH_SCOPE(reports) \
+    ApprovalMetrics::countBatch(reports); \
+    ApprovalTimerScope approvalBatchScope(ApprovalMetrics::local().batchNs)
+
+#else
+
+#define APPROVAL_METRICS_ID
+#define APPROVAL_HOP_SCOPE() ((void)0)
+#define APPROVAL_COUNT() ((void)0)
+#define APPROVAL_ROUTE_SCOPE() ((void)0)
+#define APPROVAL_BATCH_SCOPE(reports) ((void)0)
+
+#endif
+
 
 class Approver{
     public:
-    Approver *next; // pointer to the next approver in the chain
+    Approver *next = nullptr; // pointer to the next approver in the chain
+    // bumped on every setNext, invalidates compiled routes; atomic because
+    // routers on other threads read it while chains are being rewired
+    static std::atomic<unsigned long long> chainVersion;
+    APPROVAL_METRICS_ID
+
+    virtual ~Approver() = default;
+
     virtual void setNext(Approver* next) {
         this->next = next;
+        chainVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    // nullptr for pass-through approvers that never approve anything
+    virtual const char* title() const {
+        return nullptr;
+    }
+
+    virtual int getApprovalLimit() const {
+        return 0;
+    }
+
+    void approve(ExpenseReport* report) const {
+        APPROVAL_COUNT();
+        std::cout << title() << " approved the expense report: " << report->getDescription() << std::endl;
     }
 
     virtual void process(ExpenseReport* report) {
@@ -38,9 +462,12 @@ class Manager : public Approver {
     int approvalLimit; // maximum amount this manager can approve
     public:
     Manager(int limit) : approvalLimit(limit) {}
+    const char* title() const override { return "Manager"; }
+    int getApprovalLimit() const override { return approvalLimit; }
     void process(ExpenseReport* report) override { // has-a
+        APPROVAL_HOP_SCOPE();
         if(report->getAmount() <= approvalLimit) {
-            std::cout << "Manager approved the expense report: " << report->getDescription() << std::endl;
+            approve(report);
         } else {
             Approver::process(report);
         }
@@ -52,9 +479,12 @@ class Director : public Approver {
     int approvalLimit; // maximum amount this director can approve
     public:
     Director(int limit) : approvalLimit(limit) {}
+    const char* title() const override { return "Director"; }
+    int getApprovalLimit() const override { return approvalLimit; }
     void process(ExpenseReport* report) override {
+        APPROVAL_HOP_SCOPE();
         if(report->getAmount() <= approvalLimit) {
-            std::cout << "Director approved the expense report: " << report->getDescription() << std::endl;
+            approve(report);
         } else {
             Approver::process(report);
         }
@@ -66,9 +496,12 @@ class VicePresident : public Approver {
     int approvalLimit; // maximum amount this vice president can approve
     public:
     VicePresident(int limit) : approvalLimit(limit) {}
+    const char* title() const override { return "Vice President"; }
+    int getApprovalLimit() const override { return approvalLimit; }
     void process(ExpenseReport* report) override {
+        APPROVAL_HOP_SCOPE();
         if(report->getAmount() <= approvalLimit) {
-            std::cout << "Vice President approved the expense report: " << report->getDescription() << std::endl;
+            approve(report);
         } else {
             Approver::process(report);
         }
@@ -76,8 +509,328 @@ class VicePresident : public Approver {
 };
 
 
+std::atomic<unsigned long long> Approver::chainVersion{0};
+
+
+// columnar batch of reports: amounts and descriptions kept apart so routing
+// only streams through the amounts; description text lives in the batch's
+// own arena and goes away with it (or with clear())
+struct ExpenseBatch {
+    std::vector<int> amounts;
+    std::vector<std::string_view> descriptions;
+    DescriptionArena arena;
+
+    void add(int amount, std::string_view description) {
+        amounts.push_back(amount);
+        descriptions.push_back(arena.store(description));
+    }
+
+    void clear() {
+        amounts.clear();
+        descriptions.clear();
+        arena.reset();
+    }
+
+    size_t size() const {
+        return amounts.size();
+    }
+};
+
+
+// decision for one report: index of the approver level that approves it
+// (see ApprovalRouter::approverAt), or kRejected
+using ApprovalDecision = int;
+constexpr ApprovalDecision kRejected = -1;
+
+
+// fixed pool of threads that split a job into parts; the caller works too
+class BatchThreadPool {
+    private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobParts = 0;
+    std::atomic<size_t> nextPart{0};
+    size_t finishedParts = 0;
+    size_t activeWorkers = 0; // workers inside runParts for the current job
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    size_t runParts(const std::function<void(size_t)>& fn, size_t parts) {
+        size_t done = 0;
+        for(size_t part = nextPart++; part < parts; part = nextPart++) {
+            fn(part);
+            ++done;
+        }
+        return done;
+    }
+
+    void workerLoop() {
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            jobReady.wait(lock, [&] { return stopping || generation != seen; });
+            if(stopping) {
+                return;
+            }
+            seen = generation;
+            if(job == nullptr) {
+                continue;
+            }
+            const std::function<void(size_t)>& fn = *job;
+            size_t parts = jobParts;
+            ++activeWorkers;
+            lock.unlock();
+            size_t done = runParts(fn, parts);
+            lock.lock();
+            --activeWorkers;
+            finishedParts += done;
+            jobDone.notify_all();
+        }
+    }
+
+    public:
+    explicit BatchThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+        for(size_t i = 1; i < std::max<size_t>(threads, 1); ++i) {
+            workers.emplace_back(&BatchThreadPool::workerLoop, this);
+        }
+    }
+
+    ~BatchThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for(auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t threadCount() const {
+        return workers.size() + 1;
+    }
+
+    // runs fn(0) .. fn(parts - 1) across the pool and waits for all of them
+    void parallelFor(size_t parts, const std::function<void(size_t)>& fn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobParts = parts;
+            nextPart = 0;
+            finishedParts = 0;
+            ++generation;
+        }
+        jobReady.notify_all();
+        size_t done = runParts(fn, parts);
+        std::unique_lock<std::mutex> lock(mutex);
+        finishedParts += done;
+        jobDone.wait(lock, [&] { return finishedParts == jobParts && activeWorkers == 0; });
+        job = nullptr;
+    }
+};
+
+
+// compiled routing: snapshots the chain into an ascending table of limits so a
+// report is routed in one step instead of a virtual call per hop.
+// Same result as head->process() for approvers that follow the
+// "approve if amount <= limit, else pass on" rule used above.
+class ApprovalRouter {
+    private:
+    Approver* head;
+    unsigned long long builtVersion = ~0ull;
+    std::vector<int> limits;          // strictly increasing
+    std::vector<Approver*> approvers; // approvers[i] owns limits[i]
+
+    void rebuild() {
+        limits.clear();
+        approvers.clear();
+        for(Approver* node = head; node != nullptr; node = node->next) {
+            if(node->title() == nullptr) {
+                continue;
+            }
+            // an approver whose limit doesn't exceed an earlier one's can never be reached
+            if(limits.empty() || node->getApprovalLimit() > limits.back()) {
+                limits.push_back(node->getApprovalLimit());
+                approvers.push_back(node);
+            }
+        }
+    }
+
+    size_t levelFor(int amount) const {
+        if(limits.size() <= 8) {
+            // branchless: count limits below the amount (vectorizes)
+            size_t index = 0;
+            for(int limit : limits) {
+                index += limit < amount;
+            }
+            return index;
+        }
+        return std::lower_bound(limits.begin(), limits.end(), amount) - limits.begin();
+    }
+
+    // read the version before walking the chain, so a setNext racing with
+    // the rebuild leaves the router stale and it rebuilds again next time
+    void refresh() {
+        unsigned long long version = Approver::chainVersion.load(std::memory_order_acquire);
+        if(builtVersion != version) {
+            rebuild();
+            builtVersion = version;
+        }
+    }
+
+    public:
+    static constexpr size_t kParallelThreshold = 1 << 16; // smaller batches stay on the caller
+    static constexpr size_t kPartSize = 1 << 14;
+
+    ApprovalRouter(Approver* chainHead) : head(chainHead) {}
+
+    // first approver in chain order whose limit covers the amount, or nullptr
+    Approver* route(int amount) {
+        refresh();
+        size_t index = levelFor(amount);
+        return index < approvers.size() ? approvers[index] : nullptr;
+    }
+
+    Approver* approverAt(ApprovalDecision level) const {
+        return level >= 0 && level < static_cast<int>(approvers.size()) ? approvers[level] : nullptr;
+    }
+
+    // routes count amounts into decisions (same length) with no I/O; large
+    // batches are split into parts across the pool when one is given
+    void routeBatch(const int* amounts, size_t count, ApprovalDecision* decisions, BatchThreadPool* pool = nullptr) {
+        APPROVAL_BATCH_SCOPE(count); // decisions only: approvals aren't counted, there are no hops
+        refresh();
+        auto routeRange = [this, amounts, decisions](size_t begin, size_t end) {
+            int levels = static_cast<int>(approvers.size());
+            for(size_t i = begin; i < end; ++i) {
+                int level = static_cast<int>(levelFor(amounts[i]));
+                decisions[i] = level < levels ? level : kRejected;
+            }
+        };
+        if(pool == nullptr || pool->threadCount() == 1 || count < kParallelThreshold) {
+            routeRange(0, count);
+            return;
+        }
+        size_t parts = (count + kPartSize - 1) / kPartSize;
+        pool->parallelFor(parts, [&](size_t part) {
+            routeRange(part * kPartSize, std::min(count, (part + 1) * kPartSize));
+        });
+    }
+
+    // verbose prints the same lines the chain would
+    std::vector<ApprovalDecision> routeBatch(const ExpenseBatch& batch, BatchThreadPool* pool = nullptr,
+                                             bool verbose = false) {
+        std::vector<ApprovalDecision> decisions(batch.size());
+        routeBatch(batch.amounts.data(), batch.size(), decisions.data(), pool);
+        if(verbose) {
+            for(size_t i = 0; i < batch.size(); ++i) {
+                if(Approver* approver = approverAt(decisions[i])) {
+                    std::cout << approver->title() << " approved the expense report: " << batch.descriptions[i] << std::endl;
+                } else {
+                    std::cout << "No approver available for this report." << std::endl;
+                }
+            }
+        }
+        return decisions;
+    }
+
+    // one hop by construction, so only the time is recorded; approve()
+    // still counts the approval against the approver's title
+    void process(ExpenseReport* report) {
+        APPROVAL_ROUTE_SCOPE();
+        if(Approver* approver = route(report->getAmount())) {
+            approver->approve(report);
+        } else {
+            std::cout << "No approver available for this report." << std::endl;
+        }
+    }
+};
+
+
+
+void benchmarkReports(size_t count) {
+    Manager manager(1000);
+    Director director(5000);
+    VicePresident vp(10000);
+    manager.setNext(&director);
+    director.setNext(&vp);
+
+    const char* descriptions[] = {"Taxi", "Office Supplies", "Quarterly vendor conference travel and lodging"};
+    std::vector<ExpenseReport> reports;
+    reports.reserve(count);
+    DescriptionArena arena;
+
+    uint64_t before = allocationCount();
+    for(size_t i = 0; i < count; ++i) {
+        reports.emplace_back(static_cast<int>(i % 12000), descriptions[i % 3], arena);
+    }
+    uint64_t built = allocationCount() - before;
+
+    uint64_t processed;
+    std::chrono::nanoseconds elapsed;
+    {
+        ScopedNullOutput silence(std::cout);
+        before = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        for(ExpenseReport& report : reports) {
+            manager.process(&report);
+        }
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        processed = allocationCount() - before;
+    }
+
+    // the same reports through the compiled router
+    ApprovalRouter router(&manager);
+    std::chrono::nanoseconds routedElapsed;
+    {
+        ScopedNullOutput silence(std::cout);
+        auto start = std::chrono::steady_clock::now();
+        for(ExpenseReport& report : reports) {
+            router.process(&report);
+        }
+        routedElapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    std::cout << "Built " << count << " reports: " << static_cast<double>(built) / count
+              << " allocations per report (arena blocks only)" << std::endl;
+    std::cout << "Processed " << count << " reports: " << static_cast<double>(processed) / count
+              << " allocations per report, " << elapsed.count() / count << " ns per report" << std::endl;
+    std::cout << "Routed " << count << " reports: " << routedElapsed.count() / count << " ns per report" << std::endl;
+
+    // a long-running router reuses one batch: clear() resets its arena, so
+    // memory stays at the high-water mark of a single batch
+    ExpenseBatch batch;
+    size_t blocksAfterFirst = 0;
+    uint64_t reuseAllocations = 0;
+    for(int round = 0; round < 10; ++round) {
+        before = allocationCount();
+        batch.clear();
+        for(size_t i = 0; i < count / 10; ++i) {
+            batch.add(static_cast<int>(i % 12000), descriptions[2]);
+        }
+        if(round == 0) {
+            blocksAfterFirst = batch.arena.blockCount();
+        } else {
+            reuseAllocations += allocationCount() - before;
+        }
+    }
+    std::cout << "10 reused batches: arena holds " << batch.arena.blockCount() << " blocks (first batch: "
+              << blocksAfterFirst << "), " << reuseAllocations << " allocations after the first" << std::endl;
+}
+
+
+int main(int argc, char* argv[]) {
+    if(argc > 1 && std::string_view(argv[1]) == "--bench") {
+        benchmarkReports(1000000);
+#ifdef APPROVAL_INSTRUMENTATION
+        ApprovalMetrics::print(std::cout);
+#endif
+        return 0;
+    }
 
-int main() {
     // Create approvers
     Manager manager(1000);
     Director director(5000);
@@ -97,5 +850,45 @@ int main() {
     manager.process(&report2); // Should be approved by Director
     manager.process(&report3); // Should be approved by Vice President
 
+    // same chain, compiled into a routing table
+    ApprovalRouter router(&manager);
+    ExpenseReport report4(7000, "Team Offsite");
+    router.process(&report1); // Manager
+    router.process(&report2); // Director
+    router.process(&report3); // No approver available, same as the chain
+    router.process(&report4); // Vice President
+
+    // changing the chain rebuilds the table on the next route
+    director.setNext(nullptr);
+    router.process(&report4); // No approver available now that the VP is unlinked
+    director.setNext(&vp);
+
+    // nightly reconciliation: a large columnar batch routed without I/O
+    ExpenseBatch nightly;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> amount(1, 15000);
+    for(int i = 0; i < 2000000; ++i) {
+        nightly.amounts.push_back(amount(rng));
+    }
+    nightly.descriptions.resize(nightly.amounts.size(), "Reconciled expense");
+
+    BatchThreadPool pool;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ApprovalDecision> decisions = router.routeBatch(nightly, &pool);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    size_t perLevel[3] = {0, 0, 0};
+    size_t rejected = 0;
+    for(ApprovalDecision decision : decisions) {
+        if(decision == kRejected) {
+            ++rejected;
+        } else {
+            ++perLevel[decision];
+        }
+    }
+    std::cout << "Routed " << nightly.size() << " reports in " << elapsed.count() << " ms on "
+              << pool.threadCount() << " thread(s): Manager " << perLevel[0] << ", Director " << perLevel[1]
+              << ", Vice President " << perLevel[2] << ", rejected " << rejected << std::endl;
+
     return 0;
 }
\ No newline at end of file
@@ -1,42 +1,137 @@
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <new>
+#include <cstddef>
+#include <chrono>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bench_support.h"
 
 class Light { //receivers 
+    mutable std::atomic<bool> on{false};
 public:
     void turnOn() const {
+        on.store(true, std::memory_order_relaxed);
         std::cout << "Light is turned ON." << std::endl;
     }
     
     void turnOff() const {
+        on.store(false, std::memory_order_relaxed);
         std::cout << "Light is turned OFF." << std::endl;
     }
+
+    bool isOn() const { return on.load(std::memory_order_relaxed); }
+
+    // sets the state without the side effects (used by journal replay)
+    void restoreState(bool isOn) const { on.store(isOn, std::memory_order_relaxed); }
+
+    // bulk API: one call (and one line of output) for a whole group of lights
+    static void turnOnAll(const Light* const* lights, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            lights[i]->on.store(true, std::memory_order_relaxed);
+        }
+        std::cout << count << " lights are turned ON." << std::endl;
+    }
+
+    static void turnOffAll(const Light* const* lights, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            lights[i]->on.store(false, std::memory_order_relaxed);
+        }
+        std::cout << count << " lights are turned OFF." << std::endl;
+    }
 };
 
 class stereoSystem {
+    mutable std::atomic<bool> playing{false};
 public:
     void playMusic() const {
+        playing.store(true, std::memory_order_relaxed);
         std::cout << "Stereo system is playing music." << std::endl;
     }
     
     void stopMusic() const {
+        playing.store(false, std::memory_order_relaxed);
         std::cout << "Stereo system has stopped music." << std::endl;
     }
+
+    bool isPlaying() const { return playing.load(std::memory_order_relaxed); }
+
+    void restoreState(bool isPlaying) const { playing.store(isPlaying, std::memory_order_relaxed); }
+
+    static void playMusicAll(const stereoSystem* const* stereos, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            stereos[i]->playing.store(true, std::memory_order_relaxed);
+        }
+        std::cout << count << " stereo systems are playing music." << std::endl;
+    }
+
+    static void stopMusicAll(const stereoSystem* const* stereos, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            stereos[i]->playing.store(false, std::memory_order_relaxed);
+        }
+        std::cout << count << " stereo systems have stopped music." << std::endl;
+    }
+};
+
+
+// which bulk receiver call a command can be folded into
+enum class BatchKind {
+    None,
+    LightOn,
+    LightOff,
+    StereoOn,
+    StereoOff,
+    Count
 };
 
 
 /// command interface
 class command {
 public:
+    virtual ~command() = default;
     virtual void undo() const = 0; 
     virtual void execute() const = 0; 
+    // the object the command acts on; commands on the same receiver run in order
+    virtual const void* receiver() const { return this; }
+    virtual BatchKind batchKind() const { return BatchKind::None; }
+    // a composite's parts in execution order, nullptr for a plain command
+    virtual const std::vector<const command*>* parts() const { return nullptr; }
+    // puts the receiver in the state execute() (or undo()) leaves it in,
+    // silently; journal replay uses this to rebuild state after a restart
+    virtual void restore(bool /*undo*/) const {}
+    // 1 when the receiver is in the state execute() leaves it in, 0 when in
+    // the state undo() leaves it in, -1 when the command can't tell (so
+    // restore(state == 0) brings a snapshotted receiver back)
+    virtual int receiverState() const { return -1; }
 };
 
 
 //concrete command for turning on the light
-class LightOnCommand : public command {
+class LightOnCommand final : public command {
     const Light& light; // reference to the light object
 public:
     LightOnCommand(const Light& l) : light(l) {}
+    BatchKind batchKind() const override { return BatchKind::LightOn; }
+    const void* receiver() const override { return &light; }
+    void restore(bool undo) const override { light.restoreState(undo ? false : true); }
+    int receiverState() const override { return light.isOn() ? 1 : 0; }
 
     void execute() const override {
         light.turnOn();
@@ -47,10 +142,14 @@ public:
     }
 };
 
-class LightOffCommand : public command {
+class LightOffCommand final : public command {
     const Light& light; // reference to the light object
 public:
     LightOffCommand(const Light& l) : light(l) {}
+    BatchKind batchKind() const override { return BatchKind::LightOff; }
+    const void* receiver() const override { return &light; }
+    void restore(bool undo) const override { light.restoreState(undo ? true : false); }
+    int receiverState() const override { return light.isOn() ? 0 : 1; }
 
     void execute() const override {
         light.turnOff();
@@ -63,10 +162,14 @@ public:
 
 
 
-class stereoOnCommand : public command {
+class stereoOnCommand final : public command {
     const stereoSystem& stereo; // reference to the stereo system object
 public:
     stereoOnCommand(const stereoSystem& s) : stereo(s) {}
+    BatchKind batchKind() const override { return BatchKind::StereoOn; }
+    const void* receiver() const override { return &stereo; }
+    void restore(bool undo) const override { stereo.restoreState(undo ? false : true); }
+    int receiverState() const override { return stereo.isPlaying() ? 1 : 0; }
 
     void execute() const override {
         stereo.playMusic();
@@ -77,10 +180,14 @@ public:
     }
 };
 
-class stereoOffCommand : public command {
+class stereoOffCommand final : public command {
     const stereoSystem& stereo; // reference to the stereo system object
 public:
     stereoOffCommand(const stereoSystem& s) : stereo(s) {}
+    BatchKind batchKind() const override { return BatchKind::StereoOff; }
+    const void* receiver() const override { return &stereo; }
+    void restore(bool undo) const override { stereo.restoreState(undo ? true : false); }
+    int receiverState() const override { return stereo.isPlaying() ? 0 : 1; }
 
     void execute() const override {
         stereo.stopMusic();
@@ -93,61 +200,1049 @@ public:
 
 
 
+// composite command: runs its commands in order and undoes them in reverse.
+// executeBatched() groups the commands by receiver type as they are added and
+// makes one bulk receiver call per group, which only matches execute() when
+// the commands touch different receivers (e.g. "all lights off").
+class MacroCommand : public command {
+    std::vector<const command*> commands;
+    // receivers of the batchable commands, one typed group per BatchKind
+    std::vector<const Light*> lightsOn;
+    std::vector<const Light*> lightsOff;
+    std::vector<const stereoSystem*> stereosOn;
+    std::vector<const stereoSystem*> stereosOff;
+    std::vector<const command*> unbatched; // BatchKind::None, run one by one
+
+    static void switchLights(const std::vector<const Light*>& lights, bool on) {
+        if (lights.empty()) {
+            return;
+        }
+        if (on) {
+            Light::turnOnAll(lights.data(), lights.size());
+        } else {
+            Light::turnOffAll(lights.data(), lights.size());
+        }
+    }
+
+    static void switchStereos(const std::vector<const stereoSystem*>& stereos, bool playing) {
+        if (stereos.empty()) {
+            return;
+        }
+        if (playing) {
+            stereoSystem::playMusicAll(stereos.data(), stereos.size());
+        } else {
+            stereoSystem::stopMusicAll(stereos.data(), stereos.size());
+        }
+    }
+
+    // runs one group's bulk call; inverse selects the opposite action (for undo)
+    void dispatchGroup(BatchKind kind, bool inverse) const {
+        switch (kind) {
+            case BatchKind::LightOn: switchLights(lightsOn, !inverse); break;
+            case BatchKind::LightOff: switchLights(lightsOff, inverse); break;
+            case BatchKind::StereoOn: switchStereos(stereosOn, !inverse); break;
+            case BatchKind::StereoOff: switchStereos(stereosOff, inverse); break;
+            default: break;
+        }
+    }
+
+public:
+    void add(const command* cmd) {
+        commands.push_back(cmd);
+        // receiver() hands back the receiver's own address as const void*,
+        // so casting it back to the receiver type its BatchKind names is exact
+        switch (cmd->batchKind()) {
+            case BatchKind::LightOn: lightsOn.push_back(static_cast<const Light*>(cmd->receiver())); break;
+            case BatchKind::LightOff: lightsOff.push_back(static_cast<const Light*>(cmd->receiver())); break;
+            case BatchKind::StereoOn: stereosOn.push_back(static_cast<const stereoSystem*>(cmd->receiver())); break;
+            case BatchKind::StereoOff: stereosOff.push_back(static_cast<const stereoSystem*>(cmd->receiver())); break;
+            default: unbatched.push_back(cmd); break;
+        }
+    }
+
+    size_t size() const { return commands.size(); }
+
+    const std::vector<const command*>* parts() const override { return &commands; }
+
+    void restore(bool undo) const override {
+        if (undo) {
+            for (auto it = commands.rbegin(); it != commands.rend(); ++it) {
+                (*it)->restore(true);
+            }
+        } else {
+            for (const command* cmd : commands) {
+                cmd->restore(false);
+            }
+        }
+    }
+
+    void execute() const override {
+        for (const command* cmd : commands) {
+            cmd->execute();
+        }
+    }
+
+    void undo() const override {
+        for (auto it = commands.rbegin(); it != commands.rend(); ++it) {
+            (*it)->undo();
+        }
+    }
+
+    void executeBatched() const {
+        for (size_t kind = 1; kind < static_cast<size_t>(BatchKind::Count); ++kind) {
+            dispatchGroup(static_cast<BatchKind>(kind), false);
+        }
+        for (const command* cmd : unbatched) {
+            cmd->execute();
+        }
+    }
+
+    void undoBatched() const {
+        for (auto it = unbatched.rbegin(); it != unbatched.rend(); ++it) {
+            (*it)->undo();
+        }
+        for (size_t kind = static_cast<size_t>(BatchKind::Count) - 1; kind >= 1; --kind) {
+            dispatchGroup(static_cast<BatchKind>(kind), true);
+        }
+    }
+};
+
+
+// one executed command in the history, named by slot and button (the
+// remote's slots own their commands, so undo runs what the slot holds now);
+// repeats of the same button are coalesced into a single entry (count > 1)
+struct HistoryEntry {
+    int slot;
+    bool offButton;
+    int count;
+};
+
+// bounded undo/redo history: a fixed ring of entries, so memory stays the same
+// however long the session runs (the oldest entry is overwritten when full).
+// record, undo and redo are O(1) and never allocate.
+template <size_t Capacity>
+class CommandHistory {
+    HistoryEntry entries[Capacity];
+    size_t oldest = 0;     // ring index of the oldest entry
+    size_t undoCount = 0;  // entries that can be undone
+    size_t redoCount = 0;  // undone entries after them that can be redone
+
+    HistoryEntry& at(size_t position) {
+        return entries[(oldest + position) % Capacity];
+    }
+
+public:
+    void record(int slot, bool offButton) {
+        redoCount = 0; // a new command discards the redo branch
+        if (undoCount > 0) {
+            HistoryEntry& last = at(undoCount - 1);
+            if (last.slot == slot && last.offButton == offButton) {
+                ++last.count;
+                return;
+            }
+        }
+        if (undoCount == Capacity) {
+            oldest = (oldest + 1) % Capacity;
+            --undoCount;
+        }
+        at(undoCount) = HistoryEntry{slot, offButton, 1};
+        ++undoCount;
+    }
+
+    // undo/redo move the cursor and return the entry; the caller runs it
+    // (inline or through the executor) so ordering stays with the invoker
+    const HistoryEntry* undo() {
+        if (undoCount == 0) {
+            return nullptr;
+        }
+        HistoryEntry& entry = at(--undoCount);
+        ++redoCount;
+        return &entry;
+    }
+
+    const HistoryEntry* redo() {
+        if (redoCount == 0) {
+            return nullptr;
+        }
+        HistoryEntry& entry = at(undoCount++);
+        --redoCount;
+        return &entry;
+    }
+
+    size_t undoDepth() const { return undoCount; }
+    size_t redoDepth() const { return redoCount; }
+};
+
+
+// asynchronous executor: a pool of workers, each with its own bounded queue.
+// Commands are routed by receiver, so everything aimed at one Light or
+// stereoSystem runs in order on one worker while different receivers run in
+// parallel. A composite (MacroCommand) is split into its parts, each queued
+// on its own receiver's worker, so it keeps that order with direct commands
+// on the same receivers; its future completes when every part has run.
+// A full queue blocks submit() (or fails trySubmit()).
+class CommandExecutor {
+public:
+    using Completion = std::function<void()>;
+
+private:
+    struct Task {
+        const command* cmd;
+        bool undo;
+        std::promise<void> done;
+        Completion onComplete;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::deque<Task> queue;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    size_t queueCapacity;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    static void run(Worker& worker) {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(worker.mutex);
+                worker.notEmpty.wait(lock, [&] { return worker.stopping || !worker.queue.empty(); });
+                if (worker.queue.empty()) {
+                    return;
+                }
+                task = std::move(worker.queue.front());
+                worker.queue.pop_front();
+            }
+            worker.notFull.notify_one();
+            try {
+                if (task.undo) {
+                    task.cmd->undo();
+                } else {
+                    task.cmd->execute();
+                }
+                task.done.set_value();
+            } catch (...) {
+                task.done.set_exception(std::current_exception());
+            }
+            if (task.onComplete) {
+                task.onComplete();
+            }
+        }
+    }
+
+    Worker& workerFor(const command* cmd) {
+        return *workers[std::hash<const void*>()(cmd->receiver()) % workers.size()];
+    }
+
+    // a composite's leaf commands in execution order, nested macros expanded
+    static void flatten(const command* cmd, std::vector<const command*>& leaves) {
+        if (const std::vector<const command*>* parts = cmd->parts()) {
+            for (const command* part : *parts) {
+                flatten(part, leaves);
+            }
+        } else {
+            leaves.push_back(cmd);
+        }
+    }
+
+    // completion state shared by the parts of one composite submission
+    struct CompositeState {
+        std::atomic<size_t> remaining;
+        std::vector<std::future<void>> parts;
+        std::promise<void> done;
+        Completion onComplete;
+    };
+
+    // the last part to finish (or submit itself, if the parts already did)
+    // collects the first exception and completes the composite's future
+    static void partFinished(const std::shared_ptr<CompositeState>& state) {
+        if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        std::exception_ptr failure;
+        for (std::future<void>& part : state->parts) {
+            if (!part.valid()) {
+                continue; // not queued: the executor was stopping
+            }
+            try {
+                part.get();
+            } catch (...) {
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+        if (failure) {
+            state->done.set_exception(failure);
+        } else {
+            state->done.set_value();
+        }
+        if (state->onComplete) {
+            state->onComplete();
+        }
+    }
+
+    std::future<void> submitComposite(const command* cmd, bool undo, Completion onComplete) {
+        std::vector<const command*> leaves;
+        flatten(cmd, leaves);
+        if (undo) {
+            std::reverse(leaves.begin(), leaves.end());
+        }
+        auto state = std::make_shared<CompositeState>();
+        // one extra count for this function, so the parts can't complete the
+        // composite before every part's future has been stored
+        state->remaining.store(leaves.size() + 1, std::memory_order_relaxed);
+        state->parts.resize(leaves.size());
+        state->onComplete = std::move(onComplete);
+        std::future<void> result = state->done.get_future();
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            std::future<void> part;
+            if (!enqueue(leaves[i], undo, [state] { partFinished(state); }, true, &part)) {
+                state->remaining.fetch_sub(1, std::memory_order_relaxed); // never runs
+            }
+            state->parts[i] = std::move(part);
+        }
+        partFinished(state);
+        return result;
+    }
+
+    bool enqueue(const command* cmd, bool undo, Completion onComplete, bool block, std::future<void>* result) {
+        Worker& worker = workerFor(cmd);
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        if (worker.queue.size() >= queueCapacity) {
+            if (!block) {
+                return false;
+            }
+            worker.notFull.wait(lock, [&] { return worker.stopping || worker.queue.size() < queueCapacity; });
+        }
+        if (worker.stopping) {
+            return false;
+        }
+        Task task{cmd, undo, std::promise<void>(), std::move(onComplete)};
+        if (result) {
+            *result = task.done.get_future();
+        }
+        worker.queue.push_back(std::move(task));
+        lock.unlock();
+        worker.notEmpty.notify_one();
+        return true;
+    }
+
+public:
+    explicit CommandExecutor(size_t threads = 2, size_t capacityPerWorker = 256)
+        : queueCapacity(capacityPerWorker == 0 ? 1 : capacityPerWorker) {
+        for (size_t i = 0; i < (threads == 0 ? 1 : threads); ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (auto& worker : workers) {
+            worker->thread = std::thread(&CommandExecutor::run, std::ref(*worker));
+        }
+    }
+
+    // finishes everything already queued
+    ~CommandExecutor() {
+        for (auto& worker : workers) {
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->stopping = true;
+            }
+            worker->notEmpty.notify_all();
+            worker->notFull.notify_all();
+        }
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    // blocks while the receiver's queue is full
+    std::future<void> submit(const command* cmd, bool undo = false, Completion onComplete = nullptr) {
+        if (cmd->parts() != nullptr) {
+            return submitComposite(cmd, undo, std::move(onComplete));
+        }
+        std::future<void> result;
+        enqueue(cmd, undo, std::move(onComplete), true, &result);
+        return result;
+    }
+
+    // returns false instead of blocking when the receiver's queue is full.
+    // Composites are refused: their parts can't be queued all-or-nothing.
+    bool trySubmit(const command* cmd, bool undo = false, Completion onComplete = nullptr) {
+        if (cmd->parts() != nullptr) {
+            return false;
+        }
+        return enqueue(cmd, undo, std::move(onComplete), false, nullptr);
+    }
+};
+
+
+// type-erased, move-only command with small-buffer storage: concrete commands
+// (anything with execute()/undo()) and plain callables up to kBufferSize bytes
+// live inside the object itself, so storing one never allocates. Running one
+// is a single call through the per-type ops table; for the final command
+// classes that call reaches execute() directly, with no further vtable lookup.
+class InlineCommand {
+public:
+    static constexpr size_t kBufferSize = 32;
+
+private:
+    struct Ops {
+        void (*execute)(void*);
+        void (*undo)(void*);
+        void (*move)(void* to, void* from);
+        void (*destroy)(void*);
+        const command* (*target)(const void*);
+    };
+
+    template <typename T, typename = void>
+    struct HasExecute : std::false_type {};
+    template <typename T>
+    struct HasExecute<T, std::void_t<decltype(std::declval<T&>().execute())>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct HasTarget : std::false_type {};
+    template <typename T>
+    struct HasTarget<T, std::void_t<decltype(std::declval<const T&>().target())>> : std::true_type {};
+
+    template <typename T>
+    static const Ops* opsFor() {
+        static const Ops ops = {
+            [](void* self) {
+                if constexpr (HasExecute<T>::value) {
+                    static_cast<T*>(self)->execute();
+                } else {
+                    (*static_cast<T*>(self))();
+                }
+            },
+            [](void* self) {
+                if constexpr (HasExecute<T>::value) {
+                    static_cast<T*>(self)->undo();
+                }
+                // plain callables have nothing to undo
+            },
+            [](void* to, void* from) { new (to) T(std::move(*static_cast<T*>(from))); },
+            [](void* self) { static_cast<T*>(self)->~T(); },
+            [](const void* self) -> const command* {
+                if constexpr (std::is_base_of<command, T>::value) {
+                    return static_cast<const T*>(self);
+                } else if constexpr (HasTarget<T>::value) {
+                    return static_cast<const T*>(self)->target();
+                } else {
+                    return nullptr;
+                }
+            },
+        };
+        return &ops;
+    }
+
+    // mutable like std::function's target: running a stateful callable is const
+    alignas(std::max_align_t) mutable unsigned char buffer[kBufferSize];
+    const Ops* ops = nullptr;
+
+    void reset() {
+        if (ops != nullptr) {
+            ops->destroy(buffer);
+            ops = nullptr;
+        }
+    }
+
+public:
+    InlineCommand() = default;
+
+    template <typename F, typename T = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same<T, InlineCommand>::value && !std::is_pointer<T>::value>>
+    InlineCommand(F&& fn) {
+        static_assert(sizeof(T) <= kBufferSize, "command too large for inline storage");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned command");
+        static_assert(std::is_nothrow_move_constructible<T>::value, "command must be nothrow movable");
+        new (buffer) T(std::forward<F>(fn));
+        ops = opsFor<T>();
+    }
+
+    InlineCommand(InlineCommand&& other) noexcept {
+        if (other.ops != nullptr) {
+            other.ops->move(buffer, other.buffer);
+            ops = other.ops;
+            other.reset();
+        }
+    }
+
+    InlineCommand& operator=(InlineCommand&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops != nullptr) {
+                other.ops->move(buffer, other.buffer);
+                ops = other.ops;
+                other.reset();
+            }
+        }
+        return *this;
+    }
+
+    InlineCommand(const InlineCommand&) = delete;
+    InlineCommand& operator=(const InlineCommand&) = delete;
+
+    ~InlineCommand() {
+        reset();
+    }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    void execute() const { ops->execute(buffer); }
+    void undo() const { ops->undo(buffer); }
+
+    // the stored command as a command (for history, journal and executor),
+    // or nullptr for a plain callable
+    const command* target() const { return ops != nullptr ? ops->target(buffer) : nullptr; }
+};
+
+
+// slot entry for a command owned elsewhere (e.g. a MacroCommand shared
+// between remotes): stores the pointer only
+class CommandRef {
+    const command* cmd;
+
+public:
+    explicit CommandRef(const command* c) : cmd(c) {}
+    void execute() const { cmd->execute(); }
+    void undo() const { cmd->undo(); }
+    const command* target() const { return cmd; }
+};
+
+
+// ON and OFF for one slot, side by side in contiguous storage
+struct CommandSlot {
+    InlineCommand on;
+    InlineCommand off;
+};
+
+
+class RemoteControl;
+
+struct JournalOptions {
+    size_t groupSize = 64;                          // records that trigger a commit early
+    std::chrono::milliseconds commitInterval{5};    // longest a record waits for its fsync
+};
+
+// one executed command, 16 bytes on disk
+struct JournalRecord {
+    static constexpr uint8_t kOffButton = 1;
+    static constexpr uint8_t kUndo = 2;
+
+    uint32_t slot;
+    uint8_t typeId;    // BatchKind of the command, checked on replay
+    uint8_t flags;
+    uint16_t reserved;
+    int64_t timestamp; // system clock, nanoseconds since the epoch
+};
+static_assert(sizeof(JournalRecord) == 16, "journal record layout");
+
+// append-only binary journal of executed commands, for crash recovery of
+// receiver state. append() only buffers; a writer thread writes whatever has
+// accumulated and makes it durable with one fdatasync per group (group commit).
+// snapshot() saves every slot's receiver state with the journal position it
+// covers, so replay() at startup restores the snapshot and then replays only
+// the records after it. A record torn by a crash is trimmed on open.
+// A failed write or fdatasync is sticky: the journal stops writing (so later
+// records can't land misaligned), and append() and sync() return false.
+class CommandJournal {
+    // followed by two int8 states per slot: the ON and the OFF command's
+    // receiverState()
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint32_t slotCount;
+        uint64_t journalRecords; // records whose effects the snapshot includes
+    };
+    static constexpr uint32_t kSnapshotMagic = 0x524d5332; // "RMS2"
+
+    std::string journalPath;
+    std::string snapshotPath;
+    JournalOptions options;
+    int fd = -1;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable committed;
+    std::vector<JournalRecord> pending;
+    uint64_t appendedCount = 0;
+    uint64_t durableCount = 0;
+    uint64_t commitCount = 0;
+    int error = 0; // errno of the first failed write/fdatasync, sticky
+    bool stopping = false;
+    std::thread writer;
+
+    // 0 on success, otherwise the errno
+    int writeAll(const char* data, size_t remaining) {
+        while (remaining > 0) {
+            ssize_t written = ::write(fd, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        while (::fdatasync(fd) != 0) {
+            if (errno != EINTR) {
+                return errno;
+            }
+        }
+        return 0;
+    }
+
+    void writeLoop() {
+        std::vector<JournalRecord> batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workAvailable.wait_for(lock, options.commitInterval, [&] {
+                return stopping || pending.size() >= options.groupSize;
+            });
+            if (pending.empty()) {
+                if (stopping) {
+                    return;
+                }
+                continue;
+            }
+            batch.swap(pending);
+            uint64_t batchEnd = appendedCount;
+            uint64_t batchStart = durableCount;
+            lock.unlock();
+
+            int result = writeAll(reinterpret_cast<const char*>(batch.data()), batch.size() * sizeof(JournalRecord));
+            if (result != 0) {
+                // drop any partial record so the file stays record-aligned
+                (void)::ftruncate(fd, static_cast<off_t>(batchStart * sizeof(JournalRecord)));
+                std::cerr << "CommandJournal: " << std::strerror(result) << ", journaling stopped" << std::endl;
+            }
+            batch.clear();
+
+            lock.lock();
+            if (result != 0) {
+                error = result;
+                pending.clear();
+                committed.notify_all(); // wakes sync() to report the failure
+                return;
+            }
+            durableCount = batchEnd;
+            ++commitCount;
+            committed.notify_all();
+        }
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+public:
+    CommandJournal(const std::string& journal, const std::string& snapshot,
+                   JournalOptions opts = JournalOptions())
+        : journalPath(journal), snapshotPath(snapshot), options(opts) {
+        if (options.groupSize == 0) {
+            options.groupSize = 1;
+        }
+        fd = ::open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            std::cerr << "CommandJournal: cannot open " << journalPath << std::endl;
+            return;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0) {
+            uint64_t complete = static_cast<uint64_t>(info.st_size) / sizeof(JournalRecord);
+            if (complete * sizeof(JournalRecord) != static_cast<uint64_t>(info.st_size)) {
+                (void)::ftruncate(fd, static_cast<off_t>(complete * sizeof(JournalRecord)));
+            }
+            appendedCount = durableCount = complete;
+        }
+        pending.reserve(options.groupSize);
+        writer = std::thread(&CommandJournal::writeLoop, this);
+    }
+
+    // commits whatever is still buffered
+    ~CommandJournal() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            workAvailable.notify_one();
+            writer.join();
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    CommandJournal(const CommandJournal&) = delete;
+    CommandJournal& operator=(const CommandJournal&) = delete;
+
+    bool isOpen() const { return fd >= 0; }
+
+    // errno of the failure that stopped the journal, 0 while healthy
+    int lastError() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return error;
+    }
+
+    // false when the journal isn't open or has failed; the record is not kept
+    bool append(int slot, const command* cmd, bool offButton, bool undo) {
+        if (fd < 0) {
+            return false;
+        }
+        JournalRecord record{static_cast<uint32_t>(slot), static_cast<uint8_t>(cmd->batchKind()),
+                             static_cast<uint8_t>((offButton ? JournalRecord::kOffButton : 0) |
+                                                  (undo ? JournalRecord::kUndo : 0)),
+                             0, now()};
+        std::unique_lock<std::mutex> lock(mutex);
+        if (error != 0) {
+            return false;
+        }
+        pending.push_back(record);
+        ++appendedCount;
+        if (pending.size() >= options.groupSize) {
+            lock.unlock();
+            workAvailable.notify_one();
+        }
+        return true;
+    }
+
+    // blocks until everything appended so far is on disk; false if that
+    // can't happen because the journal isn't open or a write/sync failed
+    bool sync() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (fd < 0) {
+            return false;
+        }
+        uint64_t target = appendedCount;
+        if (durableCount < target && error == 0) {
+            lock.unlock();
+            workAvailable.notify_one();
+            lock.lock();
+            committed.wait(lock, [&] { return durableCount >= target || error != 0; });
+        }
+        return error == 0;
+    }
+
+    uint64_t recordCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return appendedCount;
+    }
+
+    uint64_t commits() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return commitCount;
+    }
+
+    // the remote must be idle (nothing queued on its executor) so the
+    // receiver state matches the journal position being recorded. Returns
+    // false without writing when a slot's command can't report its
+    // receiver state (e.g. a MacroCommand), since replay would then skip
+    // the only records that describe that slot.
+    bool snapshot(const RemoteControl& remote);
+
+    // restores the snapshot and replays the journal tail after it; returns
+    // the number of records replayed. Call at startup, before new presses.
+    size_t replay(const RemoteControl& remote);
+};
+
+
 // invoker class
+// Each slot owns its ON and OFF commands inline (see CommandSlot); commands
+// owned elsewhere are stored by reference. Commands go through history,
+// journal and executor; plain callables run inline only, since they have no
+// receiver to route by and nothing to journal or undo. Slots hold the
+// commands the executor runs, so reassign them only while it is idle.
 class RemoteControl {
+     std::vector<CommandSlot> slots; // ON and OFF side by side, contiguous
+
      public:
-     std::vector<command*> oNommands; // vector to hold commands
-     std::vector<command*> oFFcommands; // vector to hold commands
+     static constexpr size_t kHistoryCapacity = 64;
 
+     CommandHistory<kHistoryCapacity> history; // executed commands, for undo/redo
+     CommandExecutor* executor = nullptr; // when set, commands run asynchronously on it
+     CommandJournal* journal = nullptr; // when set, every executed command is journaled
 
-     void setCommand(int slot, command* onCommand, command* offCommand) {
-        if (slot < oNommands.size() && slot < oFFcommands.size()) {
-            oNommands[slot] = onCommand;
-            oFFcommands[slot] = offCommand;
+     // runs inline, or queues on the executor when one is set
+     std::future<void> run(int slot, const command* cmd, bool offButton, bool undo = false) {
+        if (journal != nullptr && !journal->append(slot, cmd, offButton, undo)) {
+            std::cerr << "Command not journaled; it will not survive a restart." << std::endl;
+        }
+        if (executor != nullptr) {
+            return executor->submit(cmd, undo);
+        }
+        if (undo) {
+            cmd->undo();
+        } else {
+            cmd->execute();
+        }
+        std::promise<void> done;
+        done.set_value();
+        return done.get_future();
+     }
+
+     // one button press: records it for undo and runs the slot's command;
+     // false (and nothing run) when the slot is empty
+     bool press(int slot, bool offButton, std::future<void>* result) {
+        const InlineCommand* entry = at(slot, offButton);
+        if (entry == nullptr) {
+            return false;
+        }
+        if (const command* cmd = entry->target()) {
+            history.record(slot, offButton);
+            *result = run(slot, cmd, offButton);
         } else {
-            oNommands.push_back(onCommand);
-            oFFcommands.push_back(offCommand);
+            entry->execute();
+        }
+        return true;
+     }
+
+     // stores the commands in the slot by value
+     void setCommand(int slot, InlineCommand onCommand, InlineCommand offCommand) {
+        if (static_cast<size_t>(slot) >= slots.size()) {
+            slots.resize(static_cast<size_t>(slot) + 1);
+        }
+        slots[slot].on = std::move(onCommand);
+        slots[slot].off = std::move(offCommand);
+    }
+
+     // commands owned by the caller, which must outlive the slot
+     void setCommand(int slot, command* onCommand, command* offCommand) {
+        setCommand(slot, onCommand ? InlineCommand(CommandRef(onCommand)) : InlineCommand(),
+                   offCommand ? InlineCommand(CommandRef(offCommand)) : InlineCommand());
+    }
+
+     size_t slotCount() const { return slots.size(); }
+
+     // the slot's stored entry, or nullptr when the slot or button is empty
+     const InlineCommand* at(int slot, bool offButton) const {
+        if (slot < 0 || static_cast<size_t>(slot) >= slots.size()) {
+            return nullptr;
         }
+        const InlineCommand& entry = offButton ? slots[slot].off : slots[slot].on;
+        return entry ? &entry : nullptr;
+    }
+
+     // the slot's command, or nullptr when empty or a plain callable
+     const command* commandAt(int slot, bool offButton) const {
+        const InlineCommand* entry = at(slot, offButton);
+        return entry != nullptr ? entry->target() : nullptr;
     }
 };
 
 
+bool CommandJournal::snapshot(const RemoteControl& remote) {
+    if (!sync()) {
+        return false;
+    }
+    SnapshotHeader header{kSnapshotMagic, static_cast<uint32_t>(remote.slotCount()), recordCount()};
+    std::vector<int8_t> states(2 * header.slotCount, -1);
+    for (size_t slot = 0; slot < header.slotCount; ++slot) {
+        const command* commands[2] = {remote.commandAt(slot, false), remote.commandAt(slot, true)};
+        for (int side = 0; side < 2; ++side) {
+            if (commands[side] == nullptr) {
+                if (remote.at(slot, side == 1) != nullptr) {
+                    return false; // a plain callable: its effects can't be captured
+                }
+                continue;
+            }
+            int state = commands[side]->receiverState();
+            if (state < 0) {
+                return false;
+            }
+            states[2 * slot + side] = static_cast<int8_t>(state);
+        }
+    }
+
+    // write-then-rename, so a crash leaves either the old snapshot or the new
+    // one; the directory is synced too, or the rename itself may be lost
+    std::string temporaryPath = snapshotPath + ".tmp";
+    int out = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        return false;
+    }
+    bool ok = ::write(out, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+              ::write(out, states.data(), states.size()) == static_cast<ssize_t>(states.size()) &&
+              ::fsync(out) == 0;
+    ::close(out);
+    if (!ok || std::rename(temporaryPath.c_str(), snapshotPath.c_str()) != 0) {
+        return false;
+    }
+    size_t separator = snapshotPath.rfind('/');
+    std::string directory = separator == std::string::npos ? "." : snapshotPath.substr(0, separator + 1);
+    int directoryFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directoryFd < 0) {
+        return false;
+    }
+    ok = ::fsync(directoryFd) == 0;
+    ::close(directoryFd);
+    return ok;
+}
+
+size_t CommandJournal::replay(const RemoteControl& remote) {
+    uint64_t firstRecord = 0;
+    int in = ::open(snapshotPath.c_str(), O_RDONLY);
+    if (in >= 0) {
+        SnapshotHeader header;
+        if (::read(in, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+            header.magic == kSnapshotMagic) {
+            std::vector<int8_t> states(2 * static_cast<size_t>(header.slotCount));
+            if (::read(in, states.data(), states.size()) == static_cast<ssize_t>(states.size())) {
+                for (size_t slot = 0; slot < header.slotCount && slot < remote.slotCount(); ++slot) {
+                    const command* commands[2] = {remote.commandAt(slot, false), remote.commandAt(slot, true)};
+                    for (int side = 0; side < 2; ++side) {
+                        int8_t state = states[2 * slot + side];
+                        if (state >= 0 && commands[side] != nullptr) {
+                            commands[side]->restore(state == 0);
+                        }
+                    }
+                }
+                firstRecord = header.journalRecords;
+            }
+        }
+        ::close(in);
+    }
+
+    in = ::open(journalPath.c_str(), O_RDONLY);
+    if (in < 0) {
+        return 0;
+    }
+    size_t replayed = 0;
+    if (::lseek(in, static_cast<off_t>(firstRecord * sizeof(JournalRecord)), SEEK_SET) >= 0) {
+        JournalRecord records[256];
+        ssize_t bytes;
+        while ((bytes = ::read(in, records, sizeof(records))) > 0) {
+            size_t count = static_cast<size_t>(bytes) / sizeof(JournalRecord);
+            for (size_t i = 0; i < count; ++i) {
+                const JournalRecord& record = records[i];
+                const command* cmd =
+                    remote.commandAt(static_cast<int>(record.slot), (record.flags & JournalRecord::kOffButton) != 0);
+                if (cmd == nullptr || static_cast<uint8_t>(cmd->batchKind()) != record.typeId) {
+                    continue; // the slot was reassigned since the record was written
+                }
+                cmd->restore((record.flags & JournalRecord::kUndo) != 0);
+                ++replayed;
+            }
+        }
+    }
+    ::close(in);
+    return replayed;
+}
+
+
 void executeCommand(const RemoteControl& remote, int slot) {
-    if (slot < remote.oNommands.size()) {
-        remote.oNommands[slot]->execute();
+    if (const InlineCommand* entry = remote.at(slot, false)) {
+        entry->execute();
     } else {
         std::cout << "No command set for this slot." << std::endl;
     }
 }
 
 
-void onButtonPressed(const RemoteControl& remote, int slot) {
-    if (slot < remote.oNommands.size()) {
-        remote.oNommands[slot]->execute();
-    } else {
+// the returned future is ready at once unless the remote has an executor
+// (and is empty when the slot held a plain callable, which always runs inline)
+std::future<void> onButtonPressed(RemoteControl& remote, int slot) {
+    std::future<void> result;
+    if (!remote.press(slot, false, &result)) {
         std::cout << "No command set for this slot." << std::endl;
     }
+    return result;
 }
 
-void offButtonPressed(const RemoteControl& remote, int slot) {
-    if (slot < remote.oFFcommands.size()) {
-        remote.oFFcommands[slot]->execute();
-    } else {
+std::future<void> offButtonPressed(RemoteControl& remote, int slot) {
+    std::future<void> result;
+    if (!remote.press(slot, true, &result)) {
         std::cout << "No command set for this slot." << std::endl;
     }
+    return result;
 }
 
 
-void undoButtonPressed(const RemoteControl& remote, int slot) {
-    if (slot < remote.oNommands.size()) {
-        remote.oNommands[slot]->undo();
-    } else {
-        std::cout << "No command set for this slot." << std::endl;
+// undoes the most recent command (whatever slot it was on)
+std::future<void> undoButtonPressed(RemoteControl& remote) {
+    if (const HistoryEntry* entry = remote.history.undo()) {
+        if (const command* cmd = remote.commandAt(entry->slot, entry->offButton)) {
+            return remote.run(entry->slot, cmd, entry->offButton, true);
+        }
+    }
+    std::cout << "Nothing to undo." << std::endl;
+    return {};
+}
+
+std::future<void> redoButtonPressed(RemoteControl& remote) {
+    if (const HistoryEntry* entry = remote.history.redo()) {
+        if (const command* cmd = remote.commandAt(entry->slot, entry->offButton)) {
+            return remote.run(entry->slot, cmd, entry->offButton);
+        }
     }
+    std::cout << "Nothing to redo." << std::endl;
+    return {};
 }
 
 
-int main(){
+// slot dispatch through the remote's press path: commands held by reference
+// (pointer + vtable) vs the same commands stored inline in the slots
+void benchmarkSlotDispatch(int presses) {
+    const int slotCount = 8;
+    std::vector<Light> lights(slotCount);
+    std::vector<LightOnCommand> onCommands(lights.begin(), lights.end());
+    std::vector<LightOffCommand> offCommands(lights.begin(), lights.end());
+
+    RemoteControl pointerRemote;
+    RemoteControl inlineRemote;
+    for (int slot = 0; slot < slotCount; ++slot) {
+        pointerRemote.setCommand(slot, &onCommands[slot], &offCommands[slot]);
+        inlineRemote.setCommand(slot, LightOnCommand(lights[slot]), LightOffCommand(lights[slot]));
+    }
+
+    struct Result {
+        double nanosPerPress;
+        double allocationsPerPress;
+    };
+    // output discarded so the benchmark measures dispatch, not the terminal
+    auto measure = [presses](RemoteControl& remote) {
+        ScopedNullOutput silence(std::cout);
+        uint64_t allocationsBefore = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < presses; ++i) {
+            onButtonPressed(remote, i % slotCount);
+            offButtonPressed(remote, i % slotCount);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return Result{std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (2.0 * presses),
+                      (allocationCount() - allocationsBefore) / (2.0 * presses)};
+    };
+    Result pointer = measure(pointerRemote);
+    Result inlined = measure(inlineRemote);
+
+    // lambdas as commands isolate the dispatch cost from the receiver's output
+    long counter = 0;
+    RemoteControl lambdaRemote;
+    for (int slot = 0; slot < slotCount; ++slot) {
+        lambdaRemote.setCommand(slot, [&counter] { ++counter; }, [&counter] { --counter; });
+    }
+    Result lambdas = measure(lambdaRemote);
+
+    // every command press also pays for the ready future it returns
+    std::cout << "commands by reference: " << pointer.nanosPerPress << " ns/press, " << pointer.allocationsPerPress
+              << " allocations/press" << std::endl;
+    std::cout << "commands inline:       " << inlined.nanosPerPress << " ns/press, " << inlined.allocationsPerPress
+              << " allocations/press" << std::endl;
+    std::cout << "inline lambdas:        " << lambdas.nanosPerPress << " ns/press, " << lambdas.allocationsPerPress
+              << " allocations/press (counter " << counter << ")" << std::endl;
+}
+
+
+int main(int argc, char* argv[]){
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmarkSlotDispatch(5000000);
+        return 0;
+    }
+
     Light livingRoomLight;
     stereoSystem livingRoomStereo;
 
@@ -162,11 +1257,93 @@ int main(){
 
     onButtonPressed(remote, 0); // Turn on the light
     offButtonPressed(remote, 0); // Turn off the light
-    undoButtonPressed(remote, 0); // Undo last action (turn on the light)
+    undoButtonPressed(remote); // Undo last action (turn on the light)
 
     onButtonPressed(remote, 1); // Turn on the stereo
     offButtonPressed(remote, 1); // Turn off the stereo
-    undoButtonPressed(remote, 1); // Undo last action (turn on the stereo)
+    offButtonPressed(remote, 1); // Same slot, same command: coalesced with the previous press
+    undoButtonPressed(remote); // Undo last action (turn on the stereo)
+    undoButtonPressed(remote); // Undo the stereo ON (stop music)
+    redoButtonPressed(remote); // Redo the stereo ON (play music)
+
+    // macro: a whole scene at once
+    std::vector<Light> houseLights(100);
+    std::vector<LightOffCommand> allOff(houseLights.begin(), houseLights.end());
+    MacroCommand allLightsOff;
+    for (const LightOffCommand& cmd : allOff) {
+        allLightsOff.add(&cmd);
+    }
+    allLightsOff.add(&stereoOffCommand);
+    allLightsOff.executeBatched(); // one bulk call per receiver type
+    allLightsOff.undoBatched();
+    size_t lightsOn = 0;
+    for (const Light& light : houseLights) {
+        lightsOn += light.isOn();
+    }
+    std::cout << lightsOn << " of " << houseLights.size() << " house lights are on after the batched undo." << std::endl;
+
+    MacroCommand eveningScene;
+    eveningScene.add(&lightOnCommand);
+    eveningScene.add(&stereoOnCommand);
+    eveningScene.execute();
+    eveningScene.undo(); // reverse order: stereo first, then light
+
+    // value-semantic slots: commands and move-only lambdas stored inline
+    RemoteControl inlineRemote;
+    inlineRemote.setCommand(0, LightOnCommand(livingRoomLight), LightOffCommand(livingRoomLight));
+    auto note = std::make_unique<std::string>("Movie mode");
+    inlineRemote.setCommand(1, [note = std::move(note)] { std::cout << *note << " on." << std::endl; },
+                            [&livingRoomStereo] { livingRoomStereo.stopMusic(); });
+    onButtonPressed(inlineRemote, 0);
+    onButtonPressed(inlineRemote, 1);
+    offButtonPressed(inlineRemote, 1);
+    undoButtonPressed(inlineRemote); // the light command, stored inline, undoes like any other
+
+    // journal: presses survive a restart; the snapshot bounds what gets replayed
+    {
+        CommandJournal journal("remote.journal", "remote.snapshot");
+        remote.journal = &journal;
+        onButtonPressed(remote, 0);
+        journal.snapshot(remote);
+        onButtonPressed(remote, 1);
+        offButtonPressed(remote, 0);
+        undoButtonPressed(remote); // light back on
+        remote.journal = nullptr;
+    }
+    {
+        // "after a restart": fresh receivers, same slot layout
+        Light restartedLight;
+        stereoSystem restartedStereo;
+        LightOnCommand restartedLightOn(restartedLight);
+        LightOffCommand restartedLightOff(restartedLight);
+        ::stereoOnCommand restartedStereoOn(restartedStereo);
+        ::stereoOffCommand restartedStereoOff(restartedStereo);
+        RemoteControl restarted;
+        restarted.setCommand(0, &restartedLightOn, &restartedLightOff);
+        restarted.setCommand(1, &restartedStereoOn, &restartedStereoOff);
+
+        CommandJournal journal("remote.journal", "remote.snapshot");
+        size_t replayed = journal.replay(restarted);
+        std::cout << "Replayed " << replayed << " journal records: light "
+                  << (restartedLight.isOn() ? "ON" : "OFF") << ", stereo "
+                  << (restartedStereo.isPlaying() ? "playing" : "stopped") << std::endl;
+    }
+    std::remove("remote.journal");
+    std::remove("remote.snapshot");
+
+    // executor mode: each receiver's commands stay in order, receivers run in parallel
+    {
+        CommandExecutor executor(2);
+        remote.executor = &executor;
+        onButtonPressed(remote, 0);
+        onButtonPressed(remote, 1);
+        offButtonPressed(remote, 0);
+        std::future<void> last = offButtonPressed(remote, 1);
+        // the macro's parts queue behind the presses above on the same receivers
+        executor.submit(&eveningScene).wait();
+        last.wait();
+        remote.executor = nullptr;
+    }
 
     return 0;
 }
\ No newline at end of file
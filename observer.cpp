@@ -1,35 +1,640 @@
 #include<iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include <shared_mutex>
+#include <cstdlib>
 
 class Observer {
 public:
+    virtual ~Observer() = default;
     virtual void update() = 0; // Pure virtual function to be implemented by concrete observers
-}
+};
 
 class Subject{ // subject -> cricket
+public:
+    virtual ~Subject() = default;
     virtual void attach(Observer* observer) = 0; // whenever i attach a subject -> observer will be notified;
     virtual void detach(Observer* observer) = 0;
     virtual void notify() = 0;
-}
+};
+
+
+// identifies one subscription; the generation makes a stale handle (whose
+// slot has since been reused) harmless to detach
+struct SubscriberHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != UINT32_MAX; }
+};
+
+// Subscriber list that notify can walk while others attach and detach.
+// Subscribers live in fixed-size chunks reached through a fixed directory, so
+// a slot never moves once published; each slot is an atomic pointer that
+// detach simply clears. forEach() reads the slot count once and visits that
+// many slots with plain atomic loads - no lock, no retry, no allocation, so it
+// is wait-free. attach/detach take a writer-only mutex and are O(log n): the
+// lowest free slot is reused first and the slot count shrinks when the
+// highest slots empty, so forEach walks only up to the highest live
+// subscriber; a pointer -> handle map finds the slot to clear. Up to
+// kChunkSize * kMaxChunks subscribers per subject.
+//
+// A forEach already running may still call a subscriber that was just
+// detached; call synchronize() before destroying it if notifies may be in flight.
+// Readers register on one of two counters chosen by the current epoch;
+// synchronize() flips the epoch and drains the old counter, twice, so it
+// waits only for readers that began before it and can't be starved by
+// overlapping notifies. The grace period is a store->load handshake on both
+// sides (forEach bumps a counter then loads slots, detach clears a slot then
+// synchronize loads the counters), which acquire/release does not order, so
+// the epoch, counters and slot pointers use seq_cst there.
+template <typename T>
+class SubscriberRegistry {
+public:
+    static constexpr uint32_t kChunkSize = 1024;
+    static constexpr uint32_t kMaxChunks = 1024;
+
+private:
+    struct Slot {
+        std::atomic<T*> subscriber{nullptr};
+        uint32_t generation = 0; // writer side only
+    };
+
+    struct Chunk {
+        Slot slots[kChunkSize];
+    };
+
+    std::atomic<Chunk*> directory[kMaxChunks] = {};
+    std::atomic<uint32_t> slotCount{0};     // one past the highest occupied slot
+    mutable std::atomic<uint32_t> readerEpoch{0};
+    mutable std::atomic<uint32_t> activeReaders[2] = {};
+    mutable std::mutex synchronizeMutex;
+
+    std::mutex writerMutex;
+    // min-heap of free slots below slotCount; entries at or above it were
+    // trimmed off the end and are discarded when popped
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<T*, SubscriberHandle> handles;
+
+    // waits for every reader registered on counter `phase` after flipping
+    // readers over to the other one
+    void drainPhase(uint32_t phase) const {
+        readerEpoch.store(phase ^ 1, std::memory_order_seq_cst);
+        while (activeReaders[phase].load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    Slot& slotAt(uint32_t index) const {
+        return directory[index / kChunkSize].load(std::memory_order_acquire)->slots[index % kChunkSize];
+    }
+
+public:
+    SubscriberRegistry() = default;
+    SubscriberRegistry(const SubscriberRegistry&) = delete;
+    SubscriberRegistry& operator=(const SubscriberRegistry&) = delete;
+
+    ~SubscriberRegistry() {
+        for (auto& chunk : directory) {
+            delete chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    // attaching the same subscriber twice returns its existing handle;
+    // returns an invalid handle when the registry is full
+    SubscriberHandle attach(T* subscriber) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto existing = handles.find(subscriber);
+        if (existing != handles.end()) {
+            return existing->second;
+        }
+
+        uint32_t index = UINT32_MAX;
+        while (!freeSlots.empty() && index == UINT32_MAX) {
+            std::pop_heap(freeSlots.begin(), freeSlots.end(), std::greater<uint32_t>());
+            uint32_t candidate = freeSlots.back();
+            freeSlots.pop_back();
+            if (candidate < slotCount.load(std::memory_order_relaxed)) {
+                index = candidate;
+            }
+        }
+        if (index == UINT32_MAX) {
+            index = slotCount.load(std::memory_order_relaxed);
+            if (index == kChunkSize * kMaxChunks) {
+                return SubscriberHandle();
+            }
+            if (index % kChunkSize == 0) {
+                directory[index / kChunkSize].store(new Chunk(), std::memory_order_release);
+            }
+        }
+        Slot& slot = slotAt(index);
+        slot.subscriber.store(subscriber, std::memory_order_release);
+        if (index == slotCount.load(std::memory_order_relaxed)) {
+            slotCount.store(index + 1, std::memory_order_release);
+        }
+        SubscriberHandle handle{index, slot.generation};
+        handles.emplace(subscriber, handle);
+        return handle;
+    }
+
+    // returns the detached subscriber, or nullptr for a stale handle
+    T* detach(SubscriberHandle handle) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!handle.valid() || handle.index >= slotCount.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        Slot& slot = slotAt(handle.index);
+        T* subscriber = slot.subscriber.load(std::memory_order_relaxed);
+        if (slot.generation != handle.generation || subscriber == nullptr) {
+            return nullptr;
+        }
+        slot.subscriber.store(nullptr, std::memory_order_seq_cst);
+        ++slot.generation;
+        freeSlots.push_back(handle.index);
+        std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<uint32_t>());
+        handles.erase(subscriber);
+
+        // trim empty slots off the end so forEach stops at the last subscriber
+        uint32_t count = slotCount.load(std::memory_order_relaxed);
+        while (count > 0 && slotAt(count - 1).subscriber.load(std::memory_order_relaxed) == nullptr) {
+            --count;
+        }
+        slotCount.store(count, std::memory_order_release);
+        return subscriber;
+    }
+
+    bool detach(T* subscriber) {
+        SubscriberHandle handle;
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            auto found = handles.find(subscriber);
+            if (found == handles.end()) {
+                return false;
+            }
+            handle = found->second;
+        }
+        return detach(handle) != nullptr;
+    }
+
+    // calls fn(subscriber) for every subscriber attached when it started
+    // (and possibly some attached while it runs)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        uint32_t phase = readerEpoch.load(std::memory_order_seq_cst);
+        activeReaders[phase].fetch_add(1, std::memory_order_seq_cst);
+        uint32_t count = slotCount.load(std::memory_order_acquire);
+        for (uint32_t chunkIndex = 0; chunkIndex * kChunkSize < count; ++chunkIndex) {
+            Chunk* chunk = directory[chunkIndex].load(std::memory_order_acquire);
+            uint32_t end = std::min(kChunkSize, count - chunkIndex * kChunkSize);
+            for (uint32_t i = 0; i < end; ++i) {
+                if (T* subscriber = chunk->slots[i].subscriber.load(std::memory_order_seq_cst)) {
+                    fn(subscriber);
+                }
+            }
+        }
+        activeReaders[phase].fetch_sub(1, std::memory_order_release);
+    }
+
+    // waits until every forEach that started before this call has finished,
+    // so detached subscribers can be destroyed
+    void synchronize() const {
+        std::lock_guard<std::mutex> lock(synchronizeMutex);
+        uint32_t phase = readerEpoch.load(std::memory_order_relaxed);
+        drainPhase(phase);
+        drainPhase(phase ^ 1);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        return handles.size();
+    }
+};
+
+// what an observer does when its mailbox is full
+enum class MailboxPolicy {
+    Drop,           // discard the new notification
+    CoalesceLatest, // replace the newest pending one with it
+    Block           // wait for room (the fan-out helps deliver meanwhile)
+};
+
+struct MailboxOptions {
+    MailboxPolicy policy = MailboxPolicy::Block;
+    size_t capacity = 64;
+};
+
+// fixed set of worker threads draining one FIFO task queue
+class DispatchPool {
+private:
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workAvailable.wait(lock, [&] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit DispatchPool(size_t threads) {
+        for (size_t i = 0; i < (threads == 0 ? 1 : threads); ++i) {
+            workers.emplace_back(&DispatchPool::run, this);
+        }
+    }
+
+    // finishes everything already queued
+    ~DispatchPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        workAvailable.notify_one();
+    }
+};
+
+// Asynchronous fan-out: publish() snapshots the subscribers and hands them to
+// a thread pool in chunks; each chunk posts the notification into every
+// observer's bounded mailbox, and each mailbox is drained on the pool by one
+// thread at a time, so an observer sees its notifications in order while a
+// slow one only backs up its own mailbox. A full mailbox follows its policy.
+// publish() returns once the previous notification has been posted everywhere
+// (that keeps per-observer order), so Block also throttles the publisher.
+// Subjects call track() on attach and forget() on detach; chunks skip observers
+// with no mailbox, so a notification racing a detach never revives one.
+// Observers must not publish from update().
+class AsyncDispatcher {
+public:
+    using Delivery = std::function<void(Observer*)>;
+
+private:
+    using DeliveryPtr = std::shared_ptr<const Delivery>;
+
+    struct Mailbox {
+        Observer* observer;
+        MailboxOptions options;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<DeliveryPtr> pending;
+        bool scheduled = false; // a drain task is queued or running
+        bool running = false;   // a delivery is executing right now
+        bool closed = false;    // observer detached
+
+        Mailbox(Observer* o, MailboxOptions opts) : observer(o), options(opts) {
+            if (options.capacity == 0) {
+                options.capacity = 1;
+            }
+        }
+    };
+    using MailboxPtr = std::shared_ptr<Mailbox>;
+
+    static constexpr int kDrainBudget = 16; // deliveries before a drain yields the worker
+
+    size_t chunkSize;
+    MailboxOptions defaultOptions;
+
+    std::shared_mutex mailboxesMutex;
+    std::unordered_map<Observer*, MailboxPtr> mailboxes;
+    std::unordered_map<Observer*, MailboxOptions> configured;
+
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    size_t outstandingChunks = 0;
+    size_t pendingDeliveries = 0;
+
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> coalesced{0};
+
+    DispatchPool pool; // last: its workers stop before the state above goes away
+
+    void deliveriesFinished(size_t count) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        pendingDeliveries -= count;
+        if (pendingDeliveries == 0 && outstandingChunks == 0) {
+            idle.notify_all();
+        }
+    }
+
+    // runs one pending delivery; called with the mailbox locked and not running
+    void deliverOne(Mailbox& mailbox, std::unique_lock<std::mutex>& lock) {
+        DeliveryPtr delivery = std::move(mailbox.pending.front());
+        mailbox.pending.pop_front();
+        mailbox.running = true;
+        lock.unlock();
+        (*delivery)(mailbox.observer);
+        delivered.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+        mailbox.running = false;
+        mailbox.changed.notify_all();
+        deliveriesFinished(1);
+    }
+
+    void drain(const MailboxPtr& mailbox) {
+        std::unique_lock<std::mutex> lock(mailbox->mutex);
+        for (int budget = kDrainBudget; budget > 0; --budget) {
+            mailbox->changed.wait(lock, [&] { return !mailbox->running; });
+            if (mailbox->pending.empty()) {
+                break;
+            }
+            deliverOne(*mailbox, lock);
+        }
+        if (mailbox->pending.empty()) {
+            mailbox->scheduled = false;
+        } else {
+            pool.submit([this, mailbox] { drain(mailbox); }); // let other mailboxes have the worker
+        }
+    }
+
+    void post(const MailboxPtr& mailbox, const DeliveryPtr& delivery) {
+        std::unique_lock<std::mutex> lock(mailbox->mutex);
+        while (!mailbox->closed && mailbox->pending.size() >= mailbox->options.capacity) {
+            switch (mailbox->options.policy) {
+                case MailboxPolicy::Drop:
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                case MailboxPolicy::CoalesceLatest:
+                    mailbox->pending.back() = delivery;
+                    coalesced.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                case MailboxPolicy::Block:
+                    // deliver on this thread rather than wait for a pool worker,
+                    // which may be busy running this very fan-out
+                    if (!mailbox->running) {
+                        deliverOne(*mailbox, lock);
+                    } else {
+                        mailbox->changed.wait(lock);
+                    }
+                    break;
+            }
+        }
+        if (mailbox->closed) {
+            return;
+        }
+        mailbox->pending.push_back(delivery);
+        {
+            std::lock_guard<std::mutex> idleLock(idleMutex);
+            ++pendingDeliveries;
+        }
+        if (!mailbox->scheduled) {
+            mailbox->scheduled = true;
+            pool.submit([this, mailbox] { drain(mailbox); });
+        }
+    }
+
+    void postChunk(const std::vector<Observer*>& observers, size_t begin, size_t end, const DeliveryPtr& delivery) {
+        // observers without a mailbox were never tracked or have been forgotten; skip them
+        std::vector<MailboxPtr> targets;
+        targets.reserve(end - begin);
+        {
+            std::shared_lock<std::shared_mutex> lock(mailboxesMutex);
+            for (size_t i = begin; i < end; ++i) {
+                auto found = mailboxes.find(observers[i]);
+                if (found != mailboxes.end()) {
+                    targets.push_back(found->second);
+                }
+            }
+        }
+        for (const MailboxPtr& mailbox : targets) {
+            post(mailbox, delivery);
+        }
+
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (--outstandingChunks == 0) {
+            idle.notify_all();
+        }
+    }
+
+public:
+    explicit AsyncDispatcher(size_t threads = std::thread::hardware_concurrency(), size_t observersPerChunk = 256,
+                             MailboxOptions defaults = MailboxOptions())
+        : chunkSize(observersPerChunk == 0 ? 1 : observersPerChunk), defaultOptions(defaults), pool(threads) {}
+
+    ~AsyncDispatcher() {
+        waitIdle();
+    }
+
+    AsyncDispatcher(const AsyncDispatcher&) = delete;
+    AsyncDispatcher& operator=(const AsyncDispatcher&) = delete;
+
+    // applies from the observer's next mailbox (set it before attaching)
+    // takes effect when the observer's mailbox is opened by track()
+    void setMailboxOptions(Observer* observer, MailboxOptions options) {
+        std::unique_lock<std::shared_mutex> lock(mailboxesMutex);
+        configured[observer] = options;
+    }
+
+    // opens a mailbox for a newly attached observer; publish() only delivers to tracked observers
+    void track(Observer* observer) {
+        std::unique_lock<std::shared_mutex> lock(mailboxesMutex);
+        MailboxPtr& slot = mailboxes[observer];
+        if (!slot) {
+            auto options = configured.find(observer);
+            slot = std::make_shared<Mailbox>(observer, options != configured.end() ? options->second : defaultOptions);
+        }
+    }
+
+    // T is Observer or a class derived from it
+    template <typename T>
+    void publish(const SubscriberRegistry<T>& subscribers, Delivery deliver) {
+        auto snapshot = std::make_shared<std::vector<Observer*>>();
+        subscribers.forEach([&](Observer* observer) { snapshot->push_back(observer); });
+        if (snapshot->empty()) {
+            return;
+        }
+        DeliveryPtr delivery = std::make_shared<const Delivery>(std::move(deliver));
+
+        size_t chunks = (snapshot->size() + chunkSize - 1) / chunkSize;
+        {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idle.wait(lock, [&] { return outstandingChunks == 0; });
+            outstandingChunks = chunks;
+        }
+        for (size_t begin = 0; begin < snapshot->size(); begin += chunkSize) {
+            size_t end = std::min(begin + chunkSize, snapshot->size());
+            pool.submit([this, snapshot, delivery, begin, end] { postChunk(*snapshot, begin, end, delivery); });
+        }
+    }
+
+    // drops the observer's pending notifications; one already running may
+    // still finish, so waitIdle() before destroying the observer
+    void forget(Observer* observer) {
+        MailboxPtr mailbox;
+        {
+            std::unique_lock<std::shared_mutex> lock(mailboxesMutex);
+            configured.erase(observer);
+            auto found = mailboxes.find(observer);
+            if (found == mailboxes.end()) {
+                return;
+            }
+            mailbox = std::move(found->second);
+            mailboxes.erase(found);
+        }
+        std::lock_guard<std::mutex> lock(mailbox->mutex);
+        mailbox->closed = true;
+        size_t discarded = mailbox->pending.size();
+        mailbox->pending.clear();
+        mailbox->changed.notify_all();
+        if (discarded > 0) {
+            deliveriesFinished(discarded);
+        }
+    }
+
+    // blocks until every published notification has been delivered or discarded
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [&] { return outstandingChunks == 0 && pendingDeliveries == 0; });
+    }
+
+    uint64_t deliveredCount() const { return delivered.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t coalescedCount() const { return coalesced.load(std::memory_order_relaxed); }
+};
+
+
+// immutable payloads handed to typed observers; one snapshot is shared by
+// every observer of a notification and may be kept after update() returns
+struct NewsSnapshot {
+    std::string headline;
+    uint64_t version;
+};
+
+struct StockSnapshot {
+    int stockCount;
+    uint64_t version;
+    uint64_t changesMerged; // setStockCount calls folded into this notification
+};
+
+// observer that receives the new state with the notification instead of
+// pulling it. Subscribe it through the typed registry (subscribeNews,
+// subscribeStock); the subjects reject it in attach() at compile time, and the
+// payload-less update() aborts in case it slipped in through a Subject*.
+template <typename Payload>
+class PayloadObserver : public Observer {
+public:
+    virtual void update(const std::shared_ptr<const Payload>& payload) = 0;
+    void update() final {
+        std::cerr << "PayloadObserver attached with attach(); use the typed subscribe call" << std::endl;
+        std::abort();
+    }
+};
+
 
 class NewsAgency : public Subject {
 private:
-    std::vector<Observer*> observers; // List of observers
+    SubscriberRegistry<Observer> observers; // List of observers
+    SubscriberRegistry<PayloadObserver<NewsSnapshot>> newsObservers; // typed observers
     std::string news; // News content
+    uint64_t newsVersion = 0;
+    std::shared_ptr<const NewsSnapshot> latest;
+    AsyncDispatcher* dispatcher = nullptr; // when set, notify() fans out asynchronously
 
 public:
     void attach(Observer* observer) override {
-        observers.push_back(observer);
+        observers.attach(observer);
+        if (dispatcher != nullptr) {
+            dispatcher->track(observer);
+        }
     }
+    template <typename Payload>
+    void attach(PayloadObserver<Payload>* observer) = delete; // use subscribeNews
     void detach(Observer* observer) override {
-        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+        if (observers.detach(observer) && dispatcher != nullptr) {
+            dispatcher->forget(observer);
+        }
+    }
+    // handle-based variants: O(1) detach without the pointer lookup
+    SubscriberHandle subscribe(Observer* observer) {
+        SubscriberHandle handle = observers.attach(observer);
+        if (dispatcher != nullptr) {
+            dispatcher->track(observer);
+        }
+        return handle;
+    }
+    template <typename Payload>
+    SubscriberHandle subscribe(PayloadObserver<Payload>* observer) = delete; // use subscribeNews
+    void unsubscribe(SubscriberHandle handle) {
+        Observer* observer = observers.detach(handle);
+        if (observer != nullptr && dispatcher != nullptr) {
+            dispatcher->forget(observer);
+        }
+    }
+    void subscribeNews(PayloadObserver<NewsSnapshot>* observer) {
+        newsObservers.attach(observer);
+        if (dispatcher != nullptr) {
+            dispatcher->track(observer);
+        }
+    }
+    void unsubscribeNews(PayloadObserver<NewsSnapshot>* observer) {
+        if (newsObservers.detach(observer) && dispatcher != nullptr) {
+            dispatcher->forget(observer);
+        }
+    }
+    void setDispatcher(AsyncDispatcher* asyncDispatcher) {
+        dispatcher = asyncDispatcher;
+        if (dispatcher != nullptr) {
+            observers.forEach([&](Observer* observer) { dispatcher->track(observer); });
+            newsObservers.forEach([&](Observer* observer) { dispatcher->track(observer); });
+        }
     }
     void notify() override {
-        for (Observer* observer : observers) {
-            observer->update();
+        std::shared_ptr<const NewsSnapshot> snapshot = latest;
+        auto deliverTyped = [snapshot](Observer* observer) {
+            static_cast<PayloadObserver<NewsSnapshot>*>(observer)->update(snapshot);
+        };
+        if (dispatcher != nullptr) {
+            dispatcher->publish(observers, [](Observer* observer) { observer->update(); });
+            if (snapshot) {
+                dispatcher->publish(newsObservers, deliverTyped);
+            }
+            return;
+        }
+        observers.forEach([](Observer* observer) { observer->update(); });
+        if (snapshot) {
+            newsObservers.forEach([&](PayloadObserver<NewsSnapshot>* observer) { observer->update(snapshot); });
         }
     }
+    // waits out notifies that may still reach an observer detached from either registry
+    void synchronize() const {
+        observers.synchronize();
+        newsObservers.synchronize();
+    }
     void setNews(const std::string& newsContent) { // new news came here
         news = newsContent;
+        latest = std::make_shared<const NewsSnapshot>(NewsSnapshot{news, ++newsVersion});
         notify(); // Notify all observers when news is updated
     }
 };
@@ -73,32 +678,265 @@ public:
 
 
 // observable for iphone stock
+// In coalescing mode setStockCount only records the count and marks the
+// stock dirty; tick() (driven by the caller's clock) sends one notification
+// per observer for everything since the last tick, so observer work follows
+// the tick rate rather than the mutation rate. setStockCount may be called
+// from any thread in either mode; without coalescing each call notifies on
+// the calling thread, so observers may then be updated concurrently. tick()
+// from one thread at a time.
 class iponeStock : public Subject {
 private:
-    std::vector<Observer*> observers; // List of observers
-    int stockCount; // Current stock count  
+    SubscriberRegistry<Observer> observers; // List of observers
+    SubscriberRegistry<PayloadObserver<StockSnapshot>> stockObservers; // typed observers
+    std::atomic<int> stockCount{0}; // Current stock count  
+    std::atomic<bool> coalescing{false};
+    std::atomic<bool> dirty{false};
+    std::atomic<uint64_t> pendingChanges{0};
+    std::atomic<uint64_t> stockVersion{0};
+
+    void publish(uint64_t changesMerged) {
+        auto snapshot = std::make_shared<const StockSnapshot>(
+            StockSnapshot{stockCount.load(std::memory_order_relaxed),
+                          stockVersion.fetch_add(1, std::memory_order_relaxed) + 1, changesMerged});
+        observers.forEach([](Observer* observer) { observer->update(); });
+        stockObservers.forEach([&](PayloadObserver<StockSnapshot>* observer) { observer->update(snapshot); });
+    }
+
 public:
     void attach(Observer* observer) override {  
-        observers.push_back(observer);
+        observers.attach(observer);
     }    
+    template <typename Payload>
+    void attach(PayloadObserver<Payload>* observer) = delete; // use subscribeStock
     void detach(Observer* observer) override {
-        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+        observers.detach(observer);
+    }
+    void subscribeStock(PayloadObserver<StockSnapshot>* observer) {
+        stockObservers.attach(observer);
+    }
+    void unsubscribeStock(PayloadObserver<StockSnapshot>* observer) {
+        stockObservers.detach(observer);
+    }
+    // waits out notifies that may still reach an observer detached from either registry
+    void synchronize() const {
+        observers.synchronize();
+        stockObservers.synchronize();
     }
     void notify() override {
-        for (Observer* observer : observers) {
-            observer->update();
-        }
+        publish(pendingChanges.exchange(0, std::memory_order_acq_rel));
     }   
+    void setCoalescing(bool enabled) {
+        coalescing.store(enabled, std::memory_order_relaxed);
+    }
     void setStockCount(int count) { // Update stock count
-        stockCount = count;
+        stockCount.store(count, std::memory_order_relaxed);
+        pendingChanges.fetch_add(1, std::memory_order_relaxed);
+        if (coalescing.load(std::memory_order_relaxed)) {
+            dirty.store(true, std::memory_order_release);
+            return;
+        }
         notify(); // Notify all observers when stock count changes
     }                       
+    // publishes once if anything changed since the last tick; returns whether it did
+    bool tick() {
+        if (!dirty.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        notify();
+        return true;
+    }
+    int getStockCount() const {
+        return stockCount.load(std::memory_order_relaxed);
+    }
 };
 
-int main(){
+// typed observers: they get the new state with the notification
+class HeadlineTicker : public PayloadObserver<NewsSnapshot> {
+public:
+    void update(const std::shared_ptr<const NewsSnapshot>& news) override {
+        std::cout << "Ticker #" << news->version << ": " << news->headline << std::endl;
+    }
+};
+
+class StockDisplay : public PayloadObserver<StockSnapshot> {
+public:
+    int notifications = 0;
+    std::shared_ptr<const StockSnapshot> last; // snapshots can be kept
+    void update(const std::shared_ptr<const StockSnapshot>& stock) override {
+        ++notifications;
+        last = stock;
+    }
+};
+
+// a burst of stock changes, published once per tick
+void demonstrateStockCoalescing() {
+    iponeStock stock;
+    StockDisplay display;
+    stock.subscribeStock(&display);
+    stock.setCoalescing(true);
+
+    const int changes = 100000;
+    const int changesPerTick = 10000; // e.g. 10k updates/s against a 1 s tick
+    for (int i = 1; i <= changes; ++i) {
+        stock.setStockCount(changes - i);
+        if (i % changesPerTick == 0) {
+            stock.tick();
+        }
+    }
+    stock.tick(); // nothing new: no notification
+
+    std::cout << "Stock: " << changes << " changes, " << display.notifications << " notifications; last shows "
+              << display.last->stockCount << " units (version " << display.last->version << ", "
+              << display.last->changesMerged << " changes merged)" << std::endl;
+}
+
+// counts updates; used by the scale and churn checks below
+class CountingObserver : public Observer {
+public:
+    std::atomic<uint64_t> updates{0};
+    void update() override {
+        updates.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// 100k observers on one subject: attach, notify, detach by handle
+void benchmarkRegistry(uint32_t observerCount) {
+    NewsAgency agency;
+    std::vector<std::unique_ptr<CountingObserver>> observers;
+    std::vector<SubscriberHandle> handles;
+    for (uint32_t i = 0; i < observerCount; ++i) {
+        observers.push_back(std::make_unique<CountingObserver>());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& observer : observers) {
+        handles.push_back(agency.subscribe(observer.get()));
+    }
+    std::chrono::duration<double, std::nano> attachTime = std::chrono::steady_clock::now() - start;
+
+    const int rounds = 100;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        agency.notify();
+    }
+    std::chrono::duration<double, std::nano> notifyTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (SubscriberHandle handle : handles) {
+        agency.unsubscribe(handle);
+    }
+    std::chrono::duration<double, std::nano> detachTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << observerCount << " observers: attach " << attachTime.count() / observerCount << " ns, notify "
+              << notifyTime.count() / rounds / 1e6 << " ms (" << notifyTime.count() / rounds / observerCount
+              << " ns per observer), detach " << detachTime.count() / observerCount << " ns" << std::endl;
+}
+
+// notifies continuously while another thread attaches and detaches; a
+// stable core of observers must see every notification
+bool checkChurn() {
+    NewsAgency agency;
+    std::vector<CountingObserver> stable(100);
+    std::vector<CountingObserver> churning(1000);
+    for (auto& observer : stable) {
+        agency.attach(&observer);
+    }
+
+    std::atomic<bool> done{false};
+    std::thread churner([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            for (auto& observer : churning) {
+                agency.attach(&observer);
+            }
+            for (auto& observer : churning) {
+                agency.detach(&observer);
+            }
+        }
+    });
+    const int rounds = 2000;
+    for (int round = 0; round < rounds; ++round) {
+        agency.notify();
+    }
+    done.store(true, std::memory_order_release);
+    churner.join();
+    agency.synchronize();
+
+    for (auto& observer : stable) {
+        if (observer.updates.load() != rounds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// stands in for an observer that takes a while per update
+class SlowObserver : public CountingObserver {
+public:
+    void update() override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CountingObserver::update();
+    }
+};
+
+// one slow observer among many fast ones, each with a different policy
+void demonstrateAsyncFanOut() {
+    NewsAgency agency;
+    AsyncDispatcher dispatcher(4, 64);
+    agency.setDispatcher(&dispatcher);
+
+    std::vector<CountingObserver> fast(1000);
+    SlowObserver slowCoalescing, slowDropping, slowBlocking;
+    dispatcher.setMailboxOptions(&slowCoalescing, MailboxOptions{MailboxPolicy::CoalesceLatest, 1});
+    dispatcher.setMailboxOptions(&slowDropping, MailboxOptions{MailboxPolicy::Drop, 4});
+    dispatcher.setMailboxOptions(&slowBlocking, MailboxOptions{MailboxPolicy::Block, 8});
+    for (auto& observer : fast) {
+        agency.attach(&observer);
+    }
+    agency.attach(&slowCoalescing);
+    agency.attach(&slowDropping);
+
+    const int updates = 50;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < updates; ++i) {
+        agency.setNews("Update " + std::to_string(i));
+    }
+    std::chrono::duration<double, std::milli> publishTime = std::chrono::steady_clock::now() - start;
+    dispatcher.waitIdle();
+
+    bool fastComplete = true;
+    for (auto& observer : fast) {
+        fastComplete = fastComplete && observer.updates.load() == updates;
+    }
+    std::cout << "Async fan-out: published " << updates << " updates to " << fast.size() + 2 << " observers in "
+              << publishTime.count() << " ms; fast observers got " << (fastComplete ? "all" : "NOT all")
+              << ", slow coalescing got " << slowCoalescing.updates.load() << ", slow dropping got "
+              << slowDropping.updates.load() << " (" << dispatcher.coalescedCount() << " coalesced, "
+              << dispatcher.droppedCount() << " dropped)" << std::endl;
+
+    // Block: nothing is lost, the publisher is held back to the observer's pace instead
+    agency.detach(&slowCoalescing);
+    agency.detach(&slowDropping);
+    agency.attach(&slowBlocking);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < updates; ++i) {
+        agency.setNews("Blocking update " + std::to_string(i));
+    }
+    dispatcher.waitIdle();
+    std::chrono::duration<double, std::milli> blockingTime = std::chrono::steady_clock::now() - start;
+    std::cout << "Blocking mailbox: slow observer got " << slowBlocking.updates.load() << " of " << updates
+              << " in " << blockingTime.count() << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[]){
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmarkRegistry(100000);
+        return 0;
+    }
+
     // observable
     // uber app
-    NewsAgency agency = new NewsAgency();
+    NewsAgency agency;
     
     //observers //drivers
     NewsChannel channel1;//////subscribing to notifications
@@ -120,7 +958,15 @@ int main(){
     // Set news and notify observers
     agency.setNews("Breaking News: Observer Pattern in Action!");
 
+    HeadlineTicker ticker;
+    agency.subscribeNews(&ticker);
+
     agency.detach(&app1); // Detach app1 from notifications
+    agency.setNews("Second update: BigShots no longer subscribed.");
+
+    std::cout << "Notify during attach/detach churn: " << (checkChurn() ? "every update delivered" : "FAILED") << std::endl;
+    demonstrateAsyncFanOut();
+    demonstrateStockCoalescing();
     
     return 0;
 }
\ No newline at end of file
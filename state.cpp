@@ -1,6 +1,14 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <random>
+
+#include "bench_support.h"
 
 class VendingMachine; 
 
@@ -16,13 +24,13 @@ protected:
     VendingMachine* m_machine;
 };
 
-// Context: The Vending Machine
+// Context: The Vending Machine (single-threaded; see ConcurrentVendingMachine)
 class VendingMachine {
 private:
-    std::unique_ptr<State> m_currentState;
+    State* m_currentState = nullptr; // one of the states below, never owned
     int m_itemCount = 0;
 
-    // Pointers to all possible states
+    // All possible states, built once; transitions only switch between them
     std::unique_ptr<State> m_noCoinState;
     std::unique_ptr<State> m_hasCoinState;
     std::unique_ptr<State> m_soldState;
@@ -36,10 +44,17 @@ private:
 public:
     VendingMachine(int initialItemCount);
 
-    void setState(std::unique_ptr<State> state) {
-        m_currentState = std::move(state);
+    void setState(State* state) {
+        m_currentState = state;
     }
 
+    State* getState() const { return m_currentState; }
+
+    State* getNoCoinState() const { return m_noCoinState.get(); }
+    State* getHasCoinState() const { return m_hasCoinState.get(); }
+    State* getSoldState() const { return m_soldState.get(); }
+    State* getEmptyState() const { return m_emptyState.get(); }
+
     void insertCoin() { m_currentState->insertCoin(); }
     void ejectCoin() { m_currentState->ejectCoin(); }
     void selectItem() {
@@ -102,36 +117,212 @@ VendingMachine::VendingMachine(int initialItemCount) : m_itemCount(initialItemCo
     m_emptyState = std::make_unique<EmptyState>(this);
 
     if (m_itemCount > 0) {
-        m_currentState = std::make_unique<NoCoinState>(this);
+        m_currentState = m_noCoinState.get();
     } else {
-        m_currentState = std::make_unique<EmptyState>(this);
+        m_currentState = m_emptyState.get();
     }
 }
 
 // State method implementations that cause transitions
 void NoCoinState::insertCoin() {
     std::cout << "You inserted a coin." << std::endl;
-    m_machine->setState(std::make_unique<HasCoinState>(m_machine));
+    m_machine->setState(m_machine->getHasCoinState());
 }
 
 void HasCoinState::ejectCoin() {
     std::cout << "Coin returned." << std::endl;
-    m_machine->setState(std::make_unique<NoCoinState>(m_machine));
+    m_machine->setState(m_machine->getNoCoinState());
 }
 
 void HasCoinState::selectItem() {
     std::cout << "You selected an item..." << std::endl;
-    m_machine->setState(std::make_unique<SoldState>(m_machine));
+    m_machine->setState(m_machine->getSoldState());
 }
 
 void SoldState::dispenseItem() {
     m_machine->releaseItem();
     if (m_machine->getItemCount() > 0) {
-        m_machine->setState(std::make_unique<NoCoinState>(m_machine));
+        m_machine->setState(m_machine->getNoCoinState());
     } else {
         std::cout << "Oops, out of items!" << std::endl;
-        m_machine->setState(std::make_unique<EmptyState>(m_machine));
+        m_machine->setState(m_machine->getEmptyState());
+    }
+}
+
+
+// Fleet engine: the same rules for many machines, stored as structure of
+// arrays (one byte of state and a packed item count per machine) instead of
+// one VendingMachine with five heap objects each. The state classes above are
+// flattened into a transition table; events are applied in batches, split by
+// machine shard so each thread owns a contiguous range of machines and every
+// machine still sees its events in batch order.
+enum class MachineState : uint8_t { NoCoin, HasCoin, Sold, Empty };
+enum class MachineEvent : uint8_t { InsertCoin, EjectCoin, SelectItem };
+
+struct FleetEvent {
+    uint32_t machine;
+    MachineEvent event;
+};
+
+class VendingFleet {
+private:
+    // dispense: release an item, then NoCoin or Empty depending on what's left
+    struct Transition {
+        MachineState next;
+        bool dispense;
+    };
+
+    // [state][event]; SelectItem includes the dispense step that
+    // VendingMachine::selectItem runs right after the selection
+    static constexpr Transition kTransitions[4][3] = {
+        /* NoCoin  */ {{MachineState::HasCoin, false}, {MachineState::NoCoin, false}, {MachineState::NoCoin, false}},
+        /* HasCoin */ {{MachineState::HasCoin, false}, {MachineState::NoCoin, false}, {MachineState::Sold, true}},
+        /* Sold    */ {{MachineState::Sold, false}, {MachineState::Sold, false}, {MachineState::Sold, true}},
+        /* Empty   */ {{MachineState::Empty, false}, {MachineState::Empty, false}, {MachineState::Empty, false}},
+    };
+
+    std::vector<uint8_t> m_states;
+    std::vector<uint32_t> m_itemCounts;
+    unsigned m_threadCount;
+    std::vector<std::vector<FleetEvent>> m_shardEvents; // reused between batches
+
+    size_t shardSize() const {
+        return (m_states.size() + m_threadCount - 1) / m_threadCount;
+    }
+
+    void applyEvents(const FleetEvent* events, size_t count) {
+        uint8_t* states = m_states.data();
+        uint32_t* itemCounts = m_itemCounts.data();
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t machine = events[i].machine;
+            const Transition& transition = kTransitions[states[machine]][static_cast<uint8_t>(events[i].event)];
+            if (transition.dispense) {
+                uint32_t left = itemCounts[machine];
+                if (left > 0) {
+                    itemCounts[machine] = --left;
+                }
+                states[machine] = static_cast<uint8_t>(left > 0 ? MachineState::NoCoin : MachineState::Empty);
+            } else {
+                states[machine] = static_cast<uint8_t>(transition.next);
+            }
+        }
+    }
+
+public:
+    VendingFleet(const std::vector<uint32_t>& initialItemCounts,
+                 unsigned threads = std::thread::hardware_concurrency())
+        : m_states(initialItemCounts.size()),
+          m_itemCounts(initialItemCounts),
+          m_threadCount(threads == 0 ? 1 : threads),
+          m_shardEvents(m_threadCount) {
+        for (size_t machine = 0; machine < m_states.size(); ++machine) {
+            m_states[machine] = static_cast<uint8_t>(m_itemCounts[machine] > 0 ? MachineState::NoCoin : MachineState::Empty);
+        }
+    }
+
+    // events for machines outside the fleet are ignored
+    void applyBatch(const FleetEvent* events, size_t count) {
+        if (m_threadCount == 1 || m_states.size() < m_threadCount) {
+            for (size_t i = 0; i < count; ++i) {
+                if (events[i].machine < m_states.size()) {
+                    applyEvents(&events[i], 1);
+                }
+            }
+            return;
+        }
+
+        size_t perShard = shardSize();
+        for (auto& shard : m_shardEvents) {
+            shard.clear();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (events[i].machine < m_states.size()) {
+                m_shardEvents[events[i].machine / perShard].push_back(events[i]);
+            }
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(m_threadCount - 1);
+        for (unsigned shard = 1; shard < m_threadCount; ++shard) {
+            workers.emplace_back([this, shard] {
+                applyEvents(m_shardEvents[shard].data(), m_shardEvents[shard].size());
+            });
+        }
+        applyEvents(m_shardEvents[0].data(), m_shardEvents[0].size());
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void applyBatch(const std::vector<FleetEvent>& events) {
+        applyBatch(events.data(), events.size());
+    }
+
+    size_t size() const { return m_states.size(); }
+    MachineState getState(size_t machine) const { return static_cast<MachineState>(m_states[machine]); }
+    uint32_t getItemCount(size_t machine) const { return m_itemCounts[machine]; }
+};
+
+constexpr VendingFleet::Transition VendingFleet::kTransitions[4][3];
+
+// Thread-safe machine: state and item count share one atomic word, so every
+// transition is a single compare-and-swap and no two buyers can both take the
+// last item. selectItem() goes from HasCoin straight to NoCoin/Empty with the
+// item count already decremented (Sold is never visible to other threads).
+// The calls return whether they took effect instead of printing.
+class ConcurrentVendingMachine {
+private:
+    // bits 0-7: MachineState, bits 32-63: item count
+    std::atomic<uint64_t> m_word;
+
+    static uint64_t pack(MachineState state, uint32_t itemCount) {
+        return (static_cast<uint64_t>(itemCount) << 32) | static_cast<uint8_t>(state);
+    }
+    static MachineState stateOf(uint64_t word) { return static_cast<MachineState>(word & 0xff); }
+    static uint32_t countOf(uint64_t word) { return static_cast<uint32_t>(word >> 32); }
+
+    // applies from -> to only while the machine is in `from`
+    bool transition(MachineState from, MachineState to) {
+        uint64_t current = m_word.load(std::memory_order_acquire);
+        while (stateOf(current) == from) {
+            if (m_word.compare_exchange_weak(current, pack(to, countOf(current)),
+                                             std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
     }
+
+public:
+    explicit ConcurrentVendingMachine(uint32_t initialItemCount)
+        : m_word(pack(initialItemCount > 0 ? MachineState::NoCoin : MachineState::Empty, initialItemCount)) {}
+
+    bool insertCoin() { return transition(MachineState::NoCoin, MachineState::HasCoin); }
+    bool ejectCoin() { return transition(MachineState::HasCoin, MachineState::NoCoin); }
+
+    // true when this call dispensed an item
+    bool selectItem() {
+        uint64_t current = m_word.load(std::memory_order_acquire);
+        while (stateOf(current) == MachineState::HasCoin) {
+            uint32_t left = countOf(current) - 1; // HasCoin implies at least one item
+            uint64_t next = pack(left > 0 ? MachineState::NoCoin : MachineState::Empty, left);
+            if (m_word.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    MachineState getState() const { return stateOf(m_word.load(std::memory_order_acquire)); }
+    uint32_t getItemCount() const { return countOf(m_word.load(std::memory_order_acquire)); }
+};
+
+MachineState stateOf(const VendingMachine& machine) {
+    State* state = machine.getState();
+    if (state == machine.getHasCoinState()) return MachineState::HasCoin;
+    if (state == machine.getSoldState()) return MachineState::Sold;
+    if (state == machine.getEmptyState()) return MachineState::Empty;
+    return MachineState::NoCoin;
 }
 
 
@@ -158,7 +349,291 @@ void demonstrateState() {
     std::cout << "\nDemonstration complete. The machine's behavior changed based on its internal state." << std::endl;
 }
 
-int main() {
+// The pre-change design, kept only as the --bench baseline: the same states
+// and messages, but every transition heap-allocates the next state object
+// (setState(std::make_unique<...>)) instead of switching to a preallocated one.
+namespace baseline {
+
+class Machine;
+
+class State {
+public:
+    virtual ~State() = default;
+    virtual void insertCoin(Machine& machine) = 0;
+    virtual void selectItem(Machine& machine) = 0;
+    virtual void dispenseItem(Machine& machine) = 0;
+};
+
+class Machine {
+    std::unique_ptr<State> m_currentState;
+    int m_itemCount;
+
+public:
+    explicit Machine(int itemCount);
+    void setState(std::unique_ptr<State> state) { m_currentState = std::move(state); }
+    void insertCoin() { m_currentState->insertCoin(*this); }
+    void selectItem() {
+        m_currentState->selectItem(*this);
+        m_currentState->dispenseItem(*this);
+    }
+    void releaseItem() {
+        std::cout << "Dispensing an item..." << std::endl;
+        if (m_itemCount > 0) {
+            m_itemCount--;
+        }
+    }
+    int getItemCount() const { return m_itemCount; }
+};
+
+class EmptyState : public State {
+public:
+    void insertCoin(Machine&) override { std::cout << "You can't insert a coin, the machine is sold out." << std::endl; }
+    void selectItem(Machine&) override { std::cout << "You selected an item, but there are no items." << std::endl; }
+    void dispenseItem(Machine&) override { std::cout << "No items to dispense." << std::endl; }
+};
+
+class NoCoinState : public State {
+public:
+    void insertCoin(Machine& machine) override;
+    void selectItem(Machine&) override { std::cout << "You selected an item, but there's no coin." << std::endl; }
+    void dispenseItem(Machine&) override { std::cout << "You need to pay first." << std::endl; }
+};
+
+class SoldState : public State {
+public:
+    void insertCoin(Machine&) override { std::cout << "Please wait, we're already giving you an item." << std::endl; }
+    void selectItem(Machine&) override { std::cout << "Selecting twice doesn't get you another item." << std::endl; }
+    void dispenseItem(Machine& machine) override {
+        machine.releaseItem();
+        if (machine.getItemCount() > 0) {
+            machine.setState(std::make_unique<NoCoinState>());
+        } else {
+            std::cout << "Oops, out of items!" << std::endl;
+            machine.setState(std::make_unique<EmptyState>());
+        }
+    }
+};
+
+class HasCoinState : public State {
+public:
+    void insertCoin(Machine&) override { std::cout << "You can't insert another coin." << std::endl; }
+    void selectItem(Machine& machine) override {
+        std::cout << "You selected an item..." << std::endl;
+        machine.setState(std::make_unique<SoldState>());
+    }
+    void dispenseItem(Machine&) override { std::cout << "No item dispensed." << std::endl; }
+};
+
+void NoCoinState::insertCoin(Machine& machine) {
+    std::cout << "You inserted a coin." << std::endl;
+    machine.setState(std::make_unique<HasCoinState>());
+}
+
+Machine::Machine(int itemCount) : m_itemCount(itemCount) {
+    if (m_itemCount > 0) {
+        m_currentState = std::make_unique<NoCoinState>();
+    } else {
+        m_currentState = std::make_unique<EmptyState>();
+    }
+}
+
+} // namespace baseline
+
+// purchase cycles (NoCoin -> HasCoin -> Sold -> NoCoin), output discarded
+template <typename Machine>
+void benchmarkPurchaseCycles(const char* label, int cycles) {
+    Machine machine(cycles + 1);
+
+    uint64_t allocations;
+    std::chrono::duration<double> elapsed;
+    {
+        ScopedNullOutput silence(std::cout);
+        uint64_t before = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < cycles; ++i) {
+            machine.insertCoin();
+            machine.selectItem();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        allocations = allocationCount() - before;
+    }
+
+    double transitions = 3.0 * cycles;
+    std::cout << label << ": " << cycles << " purchase cycles, " << transitions / elapsed.count() / 1e6
+              << "M transitions/s, " << allocations / transitions << " allocations per transition" << std::endl;
+}
+
+void benchmarkTransitions(int cycles) {
+    benchmarkPurchaseCycles<baseline::Machine>("baseline (state allocated per transition)", cycles);
+    benchmarkPurchaseCycles<VendingMachine>("preallocated states", cycles);
+}
+
+std::vector<FleetEvent> randomFleetEvents(size_t machines, size_t count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> machine(0, static_cast<uint32_t>(machines - 1));
+    std::uniform_int_distribution<int> event(0, 2);
+    std::vector<FleetEvent> events(count);
+    for (FleetEvent& e : events) {
+        e = FleetEvent{machine(random), static_cast<MachineEvent>(event(random))};
+    }
+    return events;
+}
+
+// runs the same random events through VendingMachine objects and the fleet
+bool verifyFleet(size_t machines, size_t eventCount, unsigned threads) {
+    std::vector<uint32_t> initialCounts(machines);
+    std::vector<std::unique_ptr<VendingMachine>> objects;
+    for (size_t i = 0; i < machines; ++i) {
+        initialCounts[i] = static_cast<uint32_t>(i % 6);
+        objects.push_back(std::make_unique<VendingMachine>(static_cast<int>(initialCounts[i])));
+    }
+    VendingFleet fleet(initialCounts, threads);
+    std::vector<FleetEvent> events = randomFleetEvents(machines, eventCount, 42);
+
+    {
+        ScopedNullOutput silence(std::cout);
+        for (const FleetEvent& e : events) {
+            VendingMachine& machine = *objects[e.machine];
+            switch (e.event) {
+                case MachineEvent::InsertCoin: machine.insertCoin(); break;
+                case MachineEvent::EjectCoin: machine.ejectCoin(); break;
+                case MachineEvent::SelectItem: machine.selectItem(); break;
+            }
+        }
+    }
+
+    // several batches, so state carries across batch boundaries
+    size_t batchSize = eventCount / 4 + 1;
+    for (size_t offset = 0; offset < events.size(); offset += batchSize) {
+        fleet.applyBatch(events.data() + offset, std::min(batchSize, events.size() - offset));
+    }
+
+    for (size_t i = 0; i < machines; ++i) {
+        if (fleet.getState(i) != stateOf(*objects[i]) ||
+            fleet.getItemCount(i) != static_cast<uint32_t>(objects[i]->getItemCount())) {
+            std::cout << "Fleet mismatch at machine " << i << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Fleet (" << threads << " threads) matches " << machines << " VendingMachine objects after "
+              << eventCount << " events" << std::endl;
+    return true;
+}
+
+void benchmarkFleet(size_t machines, size_t eventCount) {
+    std::vector<FleetEvent> events = randomFleetEvents(machines, eventCount, 7);
+    std::vector<uint32_t> initialCounts(machines, 1000);
+
+    std::vector<unsigned> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+        VendingFleet fleet(initialCounts, threads);
+        auto start = std::chrono::steady_clock::now();
+        fleet.applyBatch(events);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "fleet, " << threads << " thread(s): " << eventCount / elapsed.count() / 1e6
+                  << "M events/s over " << machines << " machines" << std::endl;
+    }
+
+    std::vector<std::unique_ptr<VendingMachine>> objects;
+    for (size_t i = 0; i < machines; ++i) {
+        objects.push_back(std::make_unique<VendingMachine>(1000));
+    }
+    std::chrono::duration<double> elapsed;
+    {
+        ScopedNullOutput silence(std::cout);
+        auto start = std::chrono::steady_clock::now();
+        for (const FleetEvent& e : events) {
+            VendingMachine& machine = *objects[e.machine];
+            switch (e.event) {
+                case MachineEvent::InsertCoin: machine.insertCoin(); break;
+                case MachineEvent::EjectCoin: machine.ejectCoin(); break;
+                case MachineEvent::SelectItem: machine.selectItem(); break;
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    std::cout << "VendingMachine objects: " << eventCount / elapsed.count() / 1e6 << "M events/s" << std::endl;
+}
+
+// `threads` buyers hammer one machine (insert, select, sometimes eject) until
+// it is sold out, then the books are checked: every item dispensed exactly
+// once and every accepted coin either spent, returned or still in the slot
+bool stressConcurrentMachine(unsigned threads, uint32_t items, bool report) {
+    ConcurrentVendingMachine machine(items);
+    std::atomic<uint64_t> coins{0}, dispensed{0}, ejected{0};
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> buyers;
+    for (unsigned t = 0; t < threads; ++t) {
+        buyers.emplace_back([&, t] {
+            uint64_t myCoins = 0, myDispensed = 0, myEjected = 0;
+            uint32_t step = t;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            while (machine.getState() != MachineState::Empty) {
+                myCoins += machine.insertCoin();
+                if (++step % 16 == 0) {
+                    myEjected += machine.ejectCoin();
+                }
+                myDispensed += machine.selectItem();
+            }
+            coins += myCoins;
+            dispensed += myDispensed;
+            ejected += myEjected;
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread& buyer : buyers) {
+        buyer.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    bool ok = dispensed == items && machine.getItemCount() == 0 && machine.getState() == MachineState::Empty &&
+              coins == dispensed + ejected;
+    if (!ok) {
+        std::cout << "Concurrent machine, " << threads << " threads: FAILED (dispensed " << dispensed << " of "
+                  << items << ", coins " << coins << ", ejected " << ejected << ")" << std::endl;
+    } else if (report) {
+        std::cout << "Concurrent machine, " << threads << " threads: " << items / elapsed.count() / 1e6
+                  << "M purchases/s, all " << items << " items dispensed exactly once" << std::endl;
+    }
+    return ok;
+}
+
+void benchmarkConcurrentMachine(uint32_t items) {
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        stressConcurrentMachine(threads, items, true);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmarkTransitions(5000000);
+        benchmarkFleet(100000, 10000000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-concurrent") {
+        benchmarkConcurrentMachine(2000000);
+        return 0;
+    }
     demonstrateState();
+
+    std::cout << std::endl;
+    verifyFleet(1000, 200000, 1);
+    verifyFleet(1000, 200000, 4);
+
+    bool concurrentOk = true;
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        for (int round = 0; round < 20; ++round) {
+            concurrentOk = stressConcurrentMachine(threads, 1 + round % 3, false) && concurrentOk;
+        }
+        concurrentOk = stressConcurrentMachine(threads, 10000, false) && concurrentOk;
+    }
+    std::cout << "Concurrent machine stress (1-64 threads): " << (concurrentOk ? "passed" : "FAILED") << std::endl;
     return 0;
 }
\ No newline at end of file